@@ -16,9 +16,10 @@ ENDIF ()
 
 find_library(DX9_D3D9_LIBRARY d3d9 ${DX9_LIBRARY_PATHS} NO_DEFAULT_PATH)
 find_library(DX9_D3DX9_LIBRARY d3dx9 ${DX9_LIBRARY_PATHS} NO_DEFAULT_PATH)
+find_library(DX9_D3DCOMPILER_LIBRARY d3dcompiler ${DX9_LIBRARY_PATHS} NO_DEFAULT_PATH)
 
-set(DX9_LIBRARIES ${DX9_D3D9_LIBRARY} ${DX9_D3DX9_LIBRARY})
+set(DX9_LIBRARIES ${DX9_D3D9_LIBRARY} ${DX9_D3DX9_LIBRARY} ${DX9_D3DCOMPILER_LIBRARY})
 
 include(FindPackageHandleStandardArgs)
 find_package_handle_standard_args(DX9 DEFAULT_MSG DX9_ROOT_DIR DX9_LIBRARIES DX9_INCLUDE_DIRS)
-mark_as_advanced(DX9_INCLUDE_DIRS DX9_D3D9_LIBRARY DX9_D3DX9_LIBRARY)
\ No newline at end of file
+mark_as_advanced(DX9_INCLUDE_DIRS DX9_D3D9_LIBRARY DX9_D3DX9_LIBRARY DX9_D3DCOMPILER_LIBRARY)
\ No newline at end of file
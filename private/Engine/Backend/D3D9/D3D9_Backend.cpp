@@ -7,23 +7,75 @@
 #include <Engine/Backend/D3D9/D3D9_ShaderProgram.hpp>
 #include <Engine/Backend/D3D9/D3D9_VertexBuffer.hpp>
 #include <Engine/Backend/D3D9/D3D9_Texture.hpp>
+#include <Engine/Backend/D3D9/D3D9_OcclusionQuery.hpp>
+#include <Engine/Backend/D3D9/D3D9_RenderTargetPool.hpp>
+#include <Engine/Backend/D3D9/D3D9_TextureBudget.hpp>
+#include <Engine/Backend/D3D9/D3D9_ResourceRegistry.hpp>
+#include <Engine/Backend/D3D9/D3D9_ShaderPack.hpp>
+#include <Engine/Backend/D3D9/D3D9_ShaderConstants.hpp>
+#include <Engine/Backend/D3D9/D3D9_ShaderVariants.hpp>
+#include <Engine/Backend/D3D9/D3D9_SpriteBatch.hpp>
 #include <Engine/Runtime/Logger.hpp>
 
 namespace engine::backend::dx9 {
     static runtime::Logger g_LoggerD3D9Backend("D3D9Backend");
 
+    static bool D3D9_HasStencil(D3DFORMAT format) {
+        return format == D3DFMT_D24S8 || format == D3DFMT_D24FS8 || format == D3DFMT_D24X4S4 || format == D3DFMT_D15S1;
+    }
+
+    D3D9Backend::D3D9Backend(IDirect3DDevice9 *device) : h_D3D9Device{device} {}
+
+    D3D9Backend::~D3D9Backend() = default;
+
     bool D3D9Backend::Initialize() {
         if (!h_D3D9Device) {
             g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "device is NULL during initialization.");
             return false;
         }
 
+        m_ResourceRegistry = std::make_unique<D3D9ResourceRegistry>();
+
+        // missing occlusion query support is not fatal, the pool then reports everything as visible
+        m_OcclusionQueries = std::make_unique<D3D9OcclusionQueryPool>(h_D3D9Device);
+        m_OcclusionQueries->Create();
+        m_ResourceRegistry->Register(m_OcclusionQueries.get());
+
+        m_TextureBudget = std::make_unique<D3D9TextureBudget>(h_D3D9Device);
+
+        m_RenderTargetPool = std::make_unique<D3D9RenderTargetPool>(h_D3D9Device, m_TextureBudget.get());
+        m_ResourceRegistry->Register(m_RenderTargetPool.get());
+
+        m_ShaderConstants = std::make_unique<D3D9ShaderConstants>();
+
+        // draws issued before the first clear should see the same state as later ones
+        m_DefaultStateApplied = false;
+        ApplyDefaultState();
+        UpdateDepthFormat();
+
         g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_INFO, "D3D9 backend initialized!");
 
         return true;
     }
 
     void D3D9Backend::Shutdown() {
+        if (h_D3D9Device) {
+            ResetRenderTarget();
+        }
+
+        if (m_ResourceRegistry) {
+            m_ResourceRegistry->Unregister(m_OcclusionQueries.get());
+            m_ResourceRegistry->Unregister(m_RenderTargetPool.get());
+        }
+
+        m_OcclusionQueries.reset();
+        m_RenderTargetPool.reset();
+
+        D3D9_ShutdownShaderCompileWorkers();
+
+        // the texture budget, shader constants and the resource registry live until the backend is destroyed,
+        // resources created through it may still reference them
+
         h_D3D9Device = nullptr;
     }
 
@@ -74,50 +126,325 @@ namespace engine::backend::dx9 {
         }
     }
 
+    bool D3D9Backend::SetRenderTarget(D3D9Texture *color, D3D9Texture *depth) {
+        if (!h_D3D9Device) {
+            g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Cannot set render target, device is not initialized.");
+            return false;
+        }
+
+        if ((color && (!color->IsRenderTarget() || color->IsDepthStencil())) || (depth && !depth->IsDepthStencil())) {
+            g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Cannot set render target, texture usage doesn't match the slot.");
+            return false;
+        }
+
+        if (!m_BackBufferSurface) {
+            h_D3D9Device->GetRenderTarget(0, &m_BackBufferSurface);
+            // fails with D3DERR_NOTFOUND when the device has no automatic depth buffer, which is fine
+            h_D3D9Device->GetDepthStencilSurface(&m_BackBufferDepthSurface);
+        }
+
+        if (color) {
+            HRESULT hr = h_D3D9Device->SetRenderTarget(0, color->GetSurface());
+            if (FAILED(hr)) {
+                g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Failed to set color render target! Error: 0x%08x", hr);
+                return false;
+            }
+        }
+
+        if (depth) {
+            HRESULT hr = h_D3D9Device->SetDepthStencilSurface(depth->GetSurface());
+            if (FAILED(hr)) {
+                g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Failed to set depth render target! Error: 0x%08x", hr);
+                return false;
+            }
+
+            UpdateDepthFormat();
+        }
+
+        return true;
+    }
+
+    void D3D9Backend::ResetRenderTarget() {
+        if (!m_BackBufferSurface) {
+            return;
+        }
+
+        h_D3D9Device->SetRenderTarget(0, m_BackBufferSurface);
+        h_D3D9Device->SetDepthStencilSurface(m_BackBufferDepthSurface);
+
+        m_BackBufferSurface->Release();
+        m_BackBufferSurface = nullptr;
+
+        if (m_BackBufferDepthSurface) {
+            m_BackBufferDepthSurface->Release();
+            m_BackBufferDepthSurface = nullptr;
+        }
+
+        UpdateDepthFormat();
+    }
+
+    bool D3D9Backend::HandleDeviceLost(D3DPRESENT_PARAMETERS *presentParameters) {
+        if (!h_D3D9Device) {
+            return false;
+        }
+
+        HRESULT hr = h_D3D9Device->TestCooperativeLevel();
+        if (SUCCEEDED(hr)) {
+            // the application reset the device itself, the released resources still have to come back
+            if (m_IsDeviceLost) {
+                return RestoreDevice();
+            }
+
+            return true;
+        }
+
+        if (!m_IsDeviceLost) {
+            g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_WARNING, "Device lost, releasing video memory resources.");
+
+            // a lost device still accepts EndScene, and BeginFrame must not think the scene is open after recovery
+            if (m_InScene) {
+                h_D3D9Device->EndScene();
+                m_InScene = false;
+            }
+
+            if (m_BackBufferSurface) {
+                m_BackBufferSurface->Release();
+                m_BackBufferSurface = nullptr;
+            }
+
+            if (m_BackBufferDepthSurface) {
+                m_BackBufferDepthSurface->Release();
+                m_BackBufferDepthSurface = nullptr;
+            }
+
+            if (m_ResourceRegistry) {
+                m_ResourceRegistry->ReleaseAll();
+            }
+
+            m_IsDeviceLost = true;
+        }
+
+        // the device can't be reset yet (e.g. the window is still minimized); try again next frame
+        if (hr != D3DERR_DEVICENOTRESET || !presentParameters) {
+            return false;
+        }
+
+        hr = h_D3D9Device->Reset(presentParameters);
+        if (FAILED(hr)) {
+            g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Failed to reset device! Error: 0x%08x", hr);
+            return false;
+        }
+
+        return RestoreDevice();
+    }
+
+    bool D3D9Backend::RestoreDevice() {
+        m_IsDeviceLost = false;
+
+        // without Initialize there is nothing registered to restore
+        bool ret = !m_ResourceRegistry || m_ResourceRegistry->RestoreAll();
+
+        // the reset also cleared the constant registers, upload the shadow copies again on the next draw
+        if (m_ShaderConstants) {
+            m_ShaderConstants->Invalidate();
+        }
+
+        // Reset brings every render state back to its default value
+        m_DefaultStateApplied = false;
+        ApplyDefaultState();
+
+        auto features = static_cast<core::runtime::graphics::BackendFeature>(m_ActiveFeatures);
+        m_ActiveFeatures = 0;
+        EnableFeatures(features);
+
+        // the automatic depth buffer may have been re-created with another format
+        UpdateDepthFormat();
+
+        if (m_ResourceRegistry) {
+            const auto &stats = m_ResourceRegistry->GetLastRecoveryStats();
+            g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_INFO, "Device recovered in %.2f ms (%u resources).", stats.m_ReleaseTimeMs + stats.m_RestoreTimeMs, static_cast<unsigned int>(stats.m_ResourceCount));
+        }
+
+        return ret;
+    }
+
+    void D3D9Backend::ApplyDefaultState() {
+        if (m_DefaultStateApplied) {
+            return;
+        }
+
+        // disable culling, both windings are drawn
+        h_D3D9Device->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+
+        // disable clipping
+        h_D3D9Device->SetRenderState(D3DRS_CLIPPING, FALSE);
+
+        // disable lighting
+        h_D3D9Device->SetRenderState(D3DRS_LIGHTING, FALSE);
+
+        // Disable zbuffer. Intended even though BeginFrame clears depth by default: 2D and UI draws must not depth
+        // test, passes that want depth enable it themselves and then rely on that clear.
+        h_D3D9Device->SetRenderState(D3DRS_ZENABLE, FALSE);
+
+        m_DefaultStateApplied = true;
+    }
+
+    void D3D9Backend::UpdateDepthFormat() {
+        m_DepthFormat = D3DFMT_UNKNOWN;
+
+        // fails with D3DERR_NOTFOUND when no depth buffer is bound
+        IDirect3DSurface9 *depthSurface = nullptr;
+        if (FAILED(h_D3D9Device->GetDepthStencilSurface(&depthSurface)) || !depthSurface) {
+            return;
+        }
+
+        D3DSURFACE_DESC desc;
+        if (SUCCEEDED(depthSurface->GetDesc(&desc))) {
+            m_DepthFormat = desc.Format;
+        }
+
+        depthSurface->Release();
+    }
+
     void D3D9Backend::Clear(core::runtime::graphics::Color color) {
         if (!h_D3D9Device) {
             g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Cannot clear, device is not initialized.");
             return;
         }
 
+        // callers that never start frames still rely on Clear to set up the render state
+        ApplyDefaultState();
+
+        D3D9ClearDesc desc;
+        desc.m_Flags = CLEAR_COLOR | CLEAR_DEPTH;
+        desc.m_Color = color;
+
+        Clear(desc);
+    }
+
+    bool D3D9Backend::Clear(const D3D9ClearDesc &desc) {
+        if (!h_D3D9Device) {
+            g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Cannot clear, device is not initialized.");
+            return false;
+        }
+
+        DWORD flags = 0;
+
+        if (desc.m_Flags & CLEAR_COLOR) {
+            flags |= D3DCLEAR_TARGET;
+        }
+
+        // clearing depth or stencil the bound surface doesn't have makes the whole Clear fail
+        if ((desc.m_Flags & CLEAR_DEPTH) && m_DepthFormat != D3DFMT_UNKNOWN) {
+            flags |= D3DCLEAR_ZBUFFER;
+        }
+
+        if ((desc.m_Flags & CLEAR_STENCIL) && D3D9_HasStencil(static_cast<D3DFORMAT>(m_DepthFormat))) {
+            flags |= D3DCLEAR_STENCIL;
+        }
+
+        if (flags == 0) {
+            return true;
+        }
+
         D3DCOLOR dxColor = D3DCOLOR_ARGB(
-                color.a,
-                color.r,
-                color.g,
-                color.b
+                desc.m_Color.a,
+                desc.m_Color.r,
+                desc.m_Color.g,
+                desc.m_Color.b
         );
 
-        DWORD renderState;
+        std::vector<D3DRECT> rects;
+        rects.reserve(desc.m_Rects.size());
 
-        // configure clockwise culling in order to allow stuff to render properly;
-        h_D3D9Device->GetRenderState(D3DRS_CULLMODE, &renderState);
-        if (renderState != D3DCULL_NONE) {
-            h_D3D9Device->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+        for (auto &rect: desc.m_Rects) {
+            rects.push_back({rect.m_Left, rect.m_Top, rect.m_Right, rect.m_Bottom});
         }
 
-        // disable clipping
-        h_D3D9Device->GetRenderState(D3DRS_CLIPPING, &renderState);
-        if (renderState != FALSE) {
-            h_D3D9Device->SetRenderState(D3DRS_CLIPPING, FALSE);
+        HRESULT hr = h_D3D9Device->Clear(
+                static_cast<DWORD>(rects.size()),
+                rects.empty() ? nullptr : rects.data(),
+                flags,
+                dxColor,
+                desc.m_Depth,
+                desc.m_Stencil
+        );
+
+        if (FAILED(hr)) {
+            g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Failed to clear the render target. Error: 0x%08x", hr);
+            return false;
         }
 
-        // disable lighting
-        h_D3D9Device->GetRenderState(D3DRS_LIGHTING, &renderState);
-        if (renderState != FALSE) {
-            h_D3D9Device->SetRenderState(D3DRS_LIGHTING, FALSE);
+        return true;
+    }
+
+    void D3D9Backend::BeginFrame(const D3D9ClearDesc &clear) {
+        if (!h_D3D9Device) {
+            g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Cannot begin frame, device is not initialized.");
+            return;
         }
 
-        // disable zbuffer
-        h_D3D9Device->GetRenderState(D3DRS_ZENABLE, &renderState);
-        if (renderState != FALSE) {
-            h_D3D9Device->SetRenderState(D3DRS_ZENABLE, FALSE);
+        if (m_InFrame) {
+            g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_WARNING, "BeginFrame called twice without EndFrame.");
         }
 
-        HRESULT hr = h_D3D9Device->Clear(0, nullptr, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, dxColor, 1.0f, 0);
-        if (FAILED(hr)) {
-            g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Failed to clear the render target.");
+        m_InFrame = true;
+
+        // nothing reaches a lost device; the frame still has to be ended, but the pools wait for the recovery
+        if (m_IsDeviceLost) {
             return;
         }
+
+        m_FrameIndex++;
+
+        ApplyDefaultState();
+
+        if (m_OcclusionQueries) {
+            m_OcclusionQueries->BeginFrame();
+        }
+
+        if (m_RenderTargetPool) {
+            m_RenderTargetPool->BeginFrame();
+        }
+
+        if (m_TextureBudget) {
+            m_TextureBudget->BeginFrame();
+        }
+
+        if (m_ShaderConstants) {
+            m_ShaderConstants->ResetStats();
+        }
+
+        Clear(clear);
+
+        // a second BeginFrame keeps the scene that is already open
+        if (!m_InScene) {
+            HRESULT hr = h_D3D9Device->BeginScene();
+
+            if (FAILED(hr)) {
+                g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Failed to begin the scene! Error: 0x%08x", hr);
+            } else {
+                m_InScene = true;
+            }
+        }
+    }
+
+    void D3D9Backend::EndFrame() {
+        if (!m_InFrame) {
+            g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_WARNING, "EndFrame called without BeginFrame.");
+        }
+
+        if (m_InScene) {
+            HRESULT hr = h_D3D9Device->EndScene();
+
+            if (FAILED(hr)) {
+                g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Failed to end the scene! Error: 0x%08x", hr);
+            }
+
+            m_InScene = false;
+        }
+
+        m_InFrame = false;
     }
 
     void D3D9Backend::EnableFeatures(core::runtime::graphics::BackendFeature featuresMask) {
@@ -183,18 +510,66 @@ namespace engine::backend::dx9 {
 
     // ToDo: use a global D3D9 device context for the objects, and use this D3D9 device for rendering
     std::unique_ptr<core::runtime::graphics::IVertexBuffer> D3D9Backend::CreateVertexBuffer() {
-        return std::make_unique<D3D9VertexBuffer>(h_D3D9Device);
+        auto buffer = std::make_unique<D3D9VertexBuffer>(h_D3D9Device, m_ResourceRegistry.get(), m_ShaderConstants.get());
+        buffer->SetMeshOptimization(m_OptimizeMeshes);
+
+        return buffer;
     }
 
     std::unique_ptr<core::runtime::graphics::IShader> D3D9Backend::CreateShader() {
         return std::make_unique<D3D9Shader>(h_D3D9Device);
     }
 
+    std::unique_ptr<core::runtime::graphics::IShader> D3D9Backend::CreateShaderFromPack(const D3D9ShaderPack &pack, std::string_view name) {
+        auto entry = pack.Find(name);
+        if (!entry) {
+            g_LoggerD3D9Backend.Log(runtime::LOG_LEVEL_ERROR, "Shader '%.*s' was not found in the shader pack.", static_cast<int>(name.size()), name.data());
+            return nullptr;
+        }
+
+        auto type = entry->m_Stage == SHADER_PACK_STAGE_VERTEX ?
+                core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX :
+                core::runtime::graphics::ShaderType::SHADER_TYPE_FRAGMENT;
+
+        // the device copies the bytecode, so the read-only mapping is never written through this span
+        auto bytecode = pack.GetBytecode(*entry);
+        std::span<unsigned char> data(const_cast<unsigned char *>(bytecode.data()), bytecode.size());
+
+        // the packer already reflected the constants, so the bytecode's constant table is never parsed at runtime
+        auto shader = std::make_unique<D3D9Shader>(h_D3D9Device);
+        if (!shader->UseCompiledShader(data, type, pack.GetConstants(*entry), pack.GetStringTable())) {
+            return nullptr;
+        }
+
+        return shader;
+    }
+
+    std::unique_ptr<D3D9SpriteBatch> D3D9Backend::CreateSpriteBatch(size_t maxQuads) {
+        auto batch = std::make_unique<D3D9SpriteBatch>(h_D3D9Device, m_ResourceRegistry.get(), maxQuads, m_ShaderConstants.get());
+        if (!batch->Create()) {
+            return nullptr;
+        }
+
+        return batch;
+    }
+
+    std::unique_ptr<D3D9ShaderVariantSet> D3D9Backend::CreateShaderVariantSet(
+            std::string source,
+            core::runtime::graphics::ShaderType type,
+            std::vector<std::string> keywords
+    ) {
+        return std::make_unique<D3D9ShaderVariantSet>(h_D3D9Device, std::move(source), type, std::move(keywords));
+    }
+
     std::unique_ptr<core::runtime::graphics::IShaderProgram> D3D9Backend::CreateShaderProgram() {
-        return std::make_unique<D3D9ShaderProgram>(h_D3D9Device);
+        return std::make_unique<D3D9ShaderProgram>(h_D3D9Device, m_ShaderConstants.get());
+    }
+
+    std::unique_ptr<D3D9UniformBlock> D3D9Backend::CreateUniformBlock(uint32_t stages, uint32_t baseRegister, uint32_t registerCount) {
+        return std::make_unique<D3D9UniformBlock>(stages, baseRegister, registerCount);
     }
 
     std::unique_ptr<core::runtime::graphics::ITexture> D3D9Backend::CreateTexture() {
-        return std::make_unique<D3D9Texture>(h_D3D9Device);
+        return std::make_unique<D3D9Texture>(h_D3D9Device, m_RenderTargetPool.get(), m_TextureBudget.get(), m_ResourceRegistry.get());
     }
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include <Engine/Backend/D3D9/D3D9_Bounds.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define D3D9_BOUNDS_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace engine::backend::dx9 {
+    // the position is the first element of the vertex declaration
+    static const float *D3D9_GetVertexPosition(const core::runtime::graphics::Vertex &vertex) {
+        return reinterpret_cast<const float *>(&vertex);
+    }
+
+    D3D9BoundingVolume D3D9_ComputeBounds(std::span<const core::runtime::graphics::Vertex> vertices) {
+        D3D9BoundingVolume bounds{};
+
+        if (vertices.empty()) {
+            return bounds;
+        }
+
+        float min[4], max[4];
+        float radiusSquared;
+
+#ifdef D3D9_BOUNDS_SSE
+        // the loads also pick up the first UV component as the 4th lane, which is ignored
+        __m128 vMin = _mm_set1_ps(std::numeric_limits<float>::max());
+        __m128 vMax = _mm_set1_ps(-std::numeric_limits<float>::max());
+
+        for (auto &vertex: vertices) {
+            __m128 position = _mm_loadu_ps(D3D9_GetVertexPosition(vertex));
+            vMin = _mm_min_ps(vMin, position);
+            vMax = _mm_max_ps(vMax, position);
+        }
+
+        _mm_storeu_ps(min, vMin);
+        _mm_storeu_ps(max, vMax);
+
+        __m128 center = _mm_mul_ps(_mm_add_ps(vMin, vMax), _mm_set1_ps(0.5f));
+        __m128 maxDistance = _mm_setzero_ps();
+
+        for (auto &vertex: vertices) {
+            __m128 delta = _mm_sub_ps(_mm_loadu_ps(D3D9_GetVertexPosition(vertex)), center);
+            delta = _mm_mul_ps(delta, delta);
+
+            __m128 distance = _mm_add_ss(delta, _mm_add_ss(
+                    _mm_shuffle_ps(delta, delta, _MM_SHUFFLE(1, 1, 1, 1)),
+                    _mm_shuffle_ps(delta, delta, _MM_SHUFFLE(2, 2, 2, 2))
+            ));
+            maxDistance = _mm_max_ss(maxDistance, distance);
+        }
+
+        _mm_store_ss(&radiusSquared, maxDistance);
+#else
+        for (int axis = 0; axis < 3; ++axis) {
+            min[axis] = std::numeric_limits<float>::max();
+            max[axis] = -std::numeric_limits<float>::max();
+        }
+
+        for (auto &vertex: vertices) {
+            const float *position = D3D9_GetVertexPosition(vertex);
+
+            for (int axis = 0; axis < 3; ++axis) {
+                min[axis] = std::min(min[axis], position[axis]);
+                max[axis] = std::max(max[axis], position[axis]);
+            }
+        }
+
+        radiusSquared = 0.0f;
+
+        for (auto &vertex: vertices) {
+            const float *position = D3D9_GetVertexPosition(vertex);
+            float distance = 0.0f;
+
+            for (int axis = 0; axis < 3; ++axis) {
+                float delta = position[axis] - (min[axis] + max[axis]) * 0.5f;
+                distance += delta * delta;
+            }
+
+            radiusSquared = std::max(radiusSquared, distance);
+        }
+#endif
+
+        bounds.m_Min = glm::vec3(min[0], min[1], min[2]);
+        bounds.m_Max = glm::vec3(max[0], max[1], max[2]);
+        bounds.m_Center = glm::vec3((min[0] + max[0]) * 0.5f, (min[1] + max[1]) * 0.5f, (min[2] + max[2]) * 0.5f);
+        bounds.m_Radius = std::sqrt(radiusSquared);
+        bounds.m_IsValid = true;
+
+        return bounds;
+    }
+
+    D3D9BoundingVolume D3D9_TransformBounds(const D3D9BoundingVolume &bounds, const glm::mat4 &transform) {
+        if (!bounds.m_IsValid || bounds.m_IsUnknown) {
+            return bounds;
+        }
+
+        D3D9BoundingVolume result{};
+        result.m_IsValid = true;
+
+        // Arvo's method: start from the translation and add the smaller/larger contribution of every axis
+        for (int row = 0; row < 3; ++row) {
+            result.m_Min[row] = transform[3][row];
+            result.m_Max[row] = transform[3][row];
+            result.m_Center[row] = transform[3][row];
+
+            for (int column = 0; column < 3; ++column) {
+                float a = transform[column][row] * bounds.m_Min[column];
+                float b = transform[column][row] * bounds.m_Max[column];
+
+                result.m_Min[row] += std::min(a, b);
+                result.m_Max[row] += std::max(a, b);
+                result.m_Center[row] += transform[column][row] * bounds.m_Center[column];
+            }
+        }
+
+        float maxScaleSquared = 0.0f;
+        for (int column = 0; column < 3; ++column) {
+            float scaleSquared = transform[column][0] * transform[column][0] +
+                                 transform[column][1] * transform[column][1] +
+                                 transform[column][2] * transform[column][2];
+            maxScaleSquared = std::max(maxScaleSquared, scaleSquared);
+        }
+
+        result.m_Radius = bounds.m_Radius * std::sqrt(maxScaleSquared);
+        return result;
+    }
+}
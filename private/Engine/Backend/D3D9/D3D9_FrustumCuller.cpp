@@ -0,0 +1,188 @@
+#include <Engine/Backend/D3D9/D3D9_FrustumCuller.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define D3D9_FRUSTUM_CULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace engine::backend::dx9 {
+    // radius of padding and empty volumes; makes every plane test fail
+    static constexpr float D3D9_REJECTED_RADIUS = -std::numeric_limits<float>::max();
+
+    // radius and extent of volumes with unknown bounds; makes every plane test pass
+    static constexpr float D3D9_ACCEPTED_EXTENT = std::numeric_limits<float>::max();
+
+    void D3D9FrustumCuller::Clear() {
+        m_CenterX.clear();
+        m_CenterY.clear();
+        m_CenterZ.clear();
+        m_ExtentX.clear();
+        m_ExtentY.clear();
+        m_ExtentZ.clear();
+        m_Radius.clear();
+        m_Count = 0;
+    }
+
+    void D3D9FrustumCuller::Reserve(size_t count) {
+        size_t padded = (count + 3) & ~size_t(3);
+
+        m_CenterX.reserve(padded);
+        m_CenterY.reserve(padded);
+        m_CenterZ.reserve(padded);
+        m_ExtentX.reserve(padded);
+        m_ExtentY.reserve(padded);
+        m_ExtentZ.reserve(padded);
+        m_Radius.reserve(padded);
+    }
+
+    uint32_t D3D9FrustumCuller::Add(const D3D9BoundingVolume &bounds) {
+        // the slot may already exist as padding of the last group of four
+        if (m_Count == m_CenterX.size()) {
+            for (int i = 0; i < 4; ++i) {
+                m_CenterX.push_back(0.0f);
+                m_CenterY.push_back(0.0f);
+                m_CenterZ.push_back(0.0f);
+                m_ExtentX.push_back(0.0f);
+                m_ExtentY.push_back(0.0f);
+                m_ExtentZ.push_back(0.0f);
+                m_Radius.push_back(D3D9_REJECTED_RADIUS);
+            }
+        }
+
+        const size_t index = m_Count++;
+
+        if (bounds.m_IsUnknown) {
+            m_CenterX[index] = 0.0f;
+            m_CenterY[index] = 0.0f;
+            m_CenterZ[index] = 0.0f;
+            m_ExtentX[index] = D3D9_ACCEPTED_EXTENT;
+            m_ExtentY[index] = D3D9_ACCEPTED_EXTENT;
+            m_ExtentZ[index] = D3D9_ACCEPTED_EXTENT;
+            m_Radius[index] = D3D9_ACCEPTED_EXTENT;
+
+            return static_cast<uint32_t>(index);
+        }
+
+        if (!bounds.m_IsValid) {
+            return static_cast<uint32_t>(index);
+        }
+
+        // the culler uses the box center for both tests; the sphere is centered there as well
+        m_CenterX[index] = bounds.m_Center.x;
+        m_CenterY[index] = bounds.m_Center.y;
+        m_CenterZ[index] = bounds.m_Center.z;
+        m_ExtentX[index] = std::max(bounds.m_Max.x - bounds.m_Center.x, bounds.m_Center.x - bounds.m_Min.x);
+        m_ExtentY[index] = std::max(bounds.m_Max.y - bounds.m_Center.y, bounds.m_Center.y - bounds.m_Min.y);
+        m_ExtentZ[index] = std::max(bounds.m_Max.z - bounds.m_Center.z, bounds.m_Center.z - bounds.m_Min.z);
+        m_Radius[index] = bounds.m_Radius;
+
+        return static_cast<uint32_t>(index);
+    }
+
+    size_t D3D9FrustumCuller::Cull(const glm::mat4 &viewProjection, std::vector<uint32_t> &visible) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        visible.clear();
+
+        // Gribb/Hartmann plane extraction; planes point inwards and are normalized for the sphere test
+        float planes[6][4];
+        for (int i = 0; i < 4; ++i) {
+            const float w = viewProjection[i][3];
+
+            planes[0][i] = w + viewProjection[i][0]; // left
+            planes[1][i] = w - viewProjection[i][0]; // right
+            planes[2][i] = w + viewProjection[i][1]; // bottom
+            planes[3][i] = w - viewProjection[i][1]; // top
+            planes[4][i] = w + viewProjection[i][2]; // near
+            planes[5][i] = w - viewProjection[i][2]; // far
+        }
+
+        for (auto &plane: planes) {
+            float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            if (length > 0.0f) {
+                for (float &component: plane) {
+                    component /= length;
+                }
+            }
+        }
+
+        const size_t groupCount = m_CenterX.size();
+
+#ifdef D3D9_FRUSTUM_CULLER_SSE
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (size_t i = 0; i < groupCount; i += 4) {
+            __m128 centerX = _mm_loadu_ps(&m_CenterX[i]);
+            __m128 centerY = _mm_loadu_ps(&m_CenterY[i]);
+            __m128 centerZ = _mm_loadu_ps(&m_CenterZ[i]);
+            __m128 extentX = _mm_loadu_ps(&m_ExtentX[i]);
+            __m128 extentY = _mm_loadu_ps(&m_ExtentY[i]);
+            __m128 extentZ = _mm_loadu_ps(&m_ExtentZ[i]);
+            __m128 radius = _mm_loadu_ps(&m_Radius[i]);
+
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+            for (auto &plane: planes) {
+                __m128 a = _mm_set1_ps(plane[0]);
+                __m128 b = _mm_set1_ps(plane[1]);
+                __m128 c = _mm_set1_ps(plane[2]);
+
+                __m128 distance = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(a, centerX), _mm_mul_ps(b, centerY)),
+                        _mm_add_ps(_mm_mul_ps(c, centerZ), _mm_set1_ps(plane[3]))
+                );
+
+                // extent of the box along the plane normal
+                __m128 projected = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, a), extentX), _mm_mul_ps(_mm_andnot_ps(signMask, b), extentY)),
+                        _mm_mul_ps(_mm_andnot_ps(signMask, c), extentZ)
+                );
+
+                __m128 reach = _mm_min_ps(radius, projected);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), zero));
+
+                if (_mm_movemask_ps(inside) == 0) {
+                    break;
+                }
+            }
+
+            int mask = _mm_movemask_ps(inside);
+            for (size_t lane = 0; mask != 0; ++lane, mask >>= 1) {
+                if ((mask & 1) && i + lane < m_Count) {
+                    visible.push_back(static_cast<uint32_t>(i + lane));
+                }
+            }
+        }
+#else
+        for (size_t i = 0; i < std::min(groupCount, m_Count); ++i) {
+            bool inside = true;
+
+            for (auto &plane: planes) {
+                float distance = plane[0] * m_CenterX[i] + plane[1] * m_CenterY[i] + plane[2] * m_CenterZ[i] + plane[3];
+                float projected = std::abs(plane[0]) * m_ExtentX[i] + std::abs(plane[1]) * m_ExtentY[i] + std::abs(plane[2]) * m_ExtentZ[i];
+
+                if (distance + std::min(m_Radius[i], projected) < 0.0f) {
+                    inside = false;
+                    break;
+                }
+            }
+
+            if (inside) {
+                visible.push_back(static_cast<uint32_t>(i));
+            }
+        }
+#endif
+
+        m_Stats.m_Tested = m_Count;
+        m_Stats.m_Visible = visible.size();
+        m_Stats.m_CullTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        return visible.size();
+    }
+}
@@ -0,0 +1,298 @@
+#include <Engine/Backend/D3D9/D3D9_MeshOptimizer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace engine::backend::dx9 {
+    namespace {
+        // Forsyth scoring parameters, as given in the original article
+        constexpr size_t FORSYTH_CACHE_SIZE = 32;
+        constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+        constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+        constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+        constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+        float D3D9_ForsythVertexScore(int cachePosition, uint32_t remainingValence) {
+            if (remainingValence == 0) {
+                // no triangles left that use this vertex
+                return -1.0f;
+            }
+
+            float score = 0.0f;
+
+            if (cachePosition >= 0) {
+                if (cachePosition < 3) {
+                    // the vertices of the last triangle get a fixed score, so the next one doesn't just reuse them
+                    score = FORSYTH_LAST_TRIANGLE_SCORE;
+                } else {
+                    const float scaler = 1.0f / static_cast<float>(FORSYTH_CACHE_SIZE - 3);
+                    score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+                }
+            }
+
+            // boost vertices with few triangles left, so lone triangles don't get stranded
+            score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingValence), -FORSYTH_VALENCE_BOOST_POWER);
+            return score;
+        }
+
+        struct VertexHash {
+            size_t operator()(const core::runtime::graphics::Vertex &vertex) const {
+                auto bytes = reinterpret_cast<const unsigned char *>(&vertex);
+                uint64_t hash = 0xcbf29ce484222325ull;
+
+                for (size_t i = 0; i < sizeof(vertex); ++i) {
+                    hash ^= bytes[i];
+                    hash *= 0x100000001b3ull;
+                }
+
+                return static_cast<size_t>(hash);
+            }
+        };
+
+        struct VertexEqual {
+            bool operator()(const core::runtime::graphics::Vertex &a, const core::runtime::graphics::Vertex &b) const {
+                return memcmp(&a, &b, sizeof(a)) == 0;
+            }
+        };
+    }
+
+    void D3D9_BuildIndexedMesh(
+            const std::vector<core::runtime::graphics::Vertex> &source,
+            std::vector<core::runtime::graphics::Vertex> &vertices,
+            std::vector<uint32_t> &indices
+    ) {
+        vertices.clear();
+        indices.clear();
+        indices.reserve(source.size());
+
+        std::unordered_map<core::runtime::graphics::Vertex, uint32_t, VertexHash, VertexEqual> lookup;
+        lookup.reserve(source.size());
+
+        for (auto &vertex: source) {
+            auto [it, inserted] = lookup.try_emplace(vertex, static_cast<uint32_t>(vertices.size()));
+            if (inserted) {
+                vertices.push_back(vertex);
+            }
+
+            indices.push_back(it->second);
+        }
+    }
+
+    void D3D9_OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount) {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0 || vertexCount == 0) {
+            return;
+        }
+
+        // triangles still to be emitted per vertex, stored as ranges of one adjacency array
+        std::vector<uint32_t> valence(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; ++i) {
+            if (indices[i] >= vertexCount) {
+                return;
+            }
+
+            valence[indices[i]]++;
+        }
+
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            offsets[v + 1] = offsets[v] + valence[v];
+        }
+
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (size_t k = 0; k < 3; ++k) {
+                adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+            }
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            vertexScore[v] = D3D9_ForsythVertexScore(-1, valence[v]);
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+
+        std::vector<uint32_t> output;
+        output.reserve(triangleCount * 3);
+
+        std::vector<uint32_t> cache, nextCache;
+        cache.reserve(FORSYTH_CACHE_SIZE + 3);
+        nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+        size_t scanCursor = 0;
+        int64_t best = -1;
+
+        for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+            if (best < 0) {
+                // nothing in the cache has triangles left; continue with the next triangle in input order
+                while (emitted[scanCursor]) {
+                    scanCursor++;
+                }
+
+                best = static_cast<int64_t>(scanCursor);
+            }
+
+            const auto triangle = static_cast<uint32_t>(best);
+            const uint32_t *corners = &indices[triangle * 3];
+
+            emitted[triangle] = true;
+            output.insert(output.end(), corners, corners + 3);
+
+            for (size_t k = 0; k < 3; ++k) {
+                uint32_t v = corners[k];
+
+                // move the triangle out of the active range of the vertex
+                uint32_t *begin = &adjacency[offsets[v]];
+                uint32_t *last = begin + valence[v] - 1;
+                for (uint32_t *it = begin; it <= last; ++it) {
+                    if (*it == triangle) {
+                        std::swap(*it, *last);
+                        break;
+                    }
+                }
+
+                valence[v]--;
+            }
+
+            // the emitted triangle moves to the front of the LRU cache
+            nextCache.clear();
+            for (size_t k = 0; k < 3; ++k) {
+                if (std::find(nextCache.begin(), nextCache.end(), corners[k]) == nextCache.end()) {
+                    nextCache.push_back(corners[k]);
+                }
+            }
+
+            for (auto v: cache) {
+                if (v != corners[0] && v != corners[1] && v != corners[2]) {
+                    nextCache.push_back(v);
+                }
+            }
+
+            for (size_t i = 0; i < nextCache.size(); ++i) {
+                uint32_t v = nextCache[i];
+                cachePosition[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+                vertexScore[v] = D3D9_ForsythVertexScore(cachePosition[v], valence[v]);
+            }
+
+            // the best candidate is the highest scoring triangle that still uses a cached vertex
+            best = -1;
+            float bestScore = -std::numeric_limits<float>::max();
+
+            for (size_t i = 0; i < std::min(nextCache.size(), FORSYTH_CACHE_SIZE); ++i) {
+                uint32_t v = nextCache[i];
+
+                for (uint32_t j = offsets[v]; j < offsets[v] + valence[v]; ++j) {
+                    uint32_t t = adjacency[j];
+                    float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+                    if (score > bestScore) {
+                        bestScore = score;
+                        best = t;
+                    }
+                }
+            }
+
+            if (nextCache.size() > FORSYTH_CACHE_SIZE) {
+                nextCache.resize(FORSYTH_CACHE_SIZE);
+            }
+
+            std::swap(cache, nextCache);
+        }
+
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    void D3D9_OptimizeVertexFetch(std::vector<core::runtime::graphics::Vertex> &vertices, std::span<uint32_t> indices) {
+        constexpr uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+
+        std::vector<uint32_t> remap(vertices.size(), UNUSED);
+        std::vector<core::runtime::graphics::Vertex> reordered;
+        reordered.reserve(vertices.size());
+
+        for (auto &index: indices) {
+            if (remap[index] == UNUSED) {
+                remap[index] = static_cast<uint32_t>(reordered.size());
+                reordered.push_back(vertices[index]);
+            }
+
+            index = remap[index];
+        }
+
+        vertices.swap(reordered);
+    }
+
+    D3D9VertexCacheStats D3D9_AnalyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, size_t cacheSize) {
+        D3D9VertexCacheStats stats{};
+        stats.m_TriangleCount = indices.size() / 3;
+
+        if (stats.m_TriangleCount == 0 || cacheSize == 0) {
+            return stats;
+        }
+
+        // FIFO cache simulated with timestamps: a vertex is a hit if fewer than cacheSize misses happened since
+        // it was last transformed
+        std::vector<size_t> timestamps(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        size_t time = cacheSize + 1;
+
+        for (size_t i = 0; i < stats.m_TriangleCount * 3; ++i) {
+            uint32_t v = indices[i];
+            if (v >= vertexCount) {
+                continue;
+            }
+
+            if (!referenced[v]) {
+                referenced[v] = true;
+                stats.m_VertexCount++;
+            }
+
+            if (time - timestamps[v] > cacheSize) {
+                timestamps[v] = time++;
+                stats.m_TransformedVertices++;
+            }
+        }
+
+        stats.m_ACMR = static_cast<double>(stats.m_TransformedVertices) / static_cast<double>(stats.m_TriangleCount);
+        stats.m_ATVR = stats.m_VertexCount > 0 ? static_cast<double>(stats.m_TransformedVertices) / static_cast<double>(stats.m_VertexCount) : 0.0;
+
+        return stats;
+    }
+
+    bool D3D9_OptimizeMesh(
+            const std::vector<core::runtime::graphics::Vertex> &source,
+            std::vector<core::runtime::graphics::Vertex> &vertices,
+            std::vector<uint32_t> &indices,
+            D3D9MeshOptimizationStats *stats
+    ) {
+        if (source.size() < 3) {
+            return false;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // trailing vertices that don't form a full triangle are never drawn
+        std::vector<core::runtime::graphics::Vertex> triangles(source.begin(), source.begin() + (source.size() / 3) * 3);
+        D3D9_BuildIndexedMesh(triangles, vertices, indices);
+
+        if (stats) {
+            stats->m_Before = D3D9_AnalyzeVertexCache(indices, vertices.size());
+        }
+
+        D3D9_OptimizeVertexCache(indices, vertices.size());
+        D3D9_OptimizeVertexFetch(vertices, indices);
+
+        if (stats) {
+            stats->m_After = D3D9_AnalyzeVertexCache(indices, vertices.size());
+            stats->m_OptimizeTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,208 @@
+#include <Engine/Backend/D3D9/D3D9_NullBackend.hpp>
+
+namespace engine::backend::dx9 {
+    struct D3D9NullVertexBuffer : public core::runtime::graphics::IVertexBuffer {
+        bool Create() override {
+            return true;
+        }
+
+        void Destroy() override {
+            m_Vertices.clear();
+        }
+
+        void Bind() override {}
+
+        void Unbind() override {}
+
+        void Draw() override {}
+
+        void Upload(
+                const std::vector<core::runtime::graphics::Vertex> &data,
+                core::runtime::graphics::PrimitiveType type,
+                core::runtime::graphics::BufferUsageHint
+        ) override {
+            m_Vertices = data;
+            m_PrimType = type;
+        }
+
+        size_t Size() override {
+            return m_Vertices.size();
+        }
+
+        core::runtime::graphics::PrimitiveType GetPrimitiveType() override {
+            return m_PrimType;
+        }
+
+        std::vector<core::runtime::graphics::Vertex> Download() override {
+            return m_Vertices;
+        }
+
+        std::vector<core::runtime::graphics::Vertex> m_Vertices;
+        core::runtime::graphics::PrimitiveType m_PrimType = core::runtime::graphics::PrimitiveType::PRIMITIVE_TYPE_TRIANGLES;
+    };
+
+    struct D3D9NullShader : public core::runtime::graphics::IShader {
+        // there is no compiler, any source "compiles"
+        bool Compile() override {
+            m_IsCompiled = !m_Source.empty();
+            return m_IsCompiled;
+        }
+
+        void Destroy() override {
+            m_IsCompiled = false;
+            m_Bytecode.clear();
+        }
+
+        void SetSource(std::string_view source, core::runtime::graphics::ShaderType type) override {
+            m_Source = source;
+            m_Type = type;
+        }
+
+        std::string GetSource() override {
+            return m_Source;
+        }
+
+        std::string GetCompileLog() override {
+            return "";
+        }
+
+        bool IsCompiled() override {
+            return m_IsCompiled;
+        }
+
+        bool UseCompiledShader(const std::span<unsigned char> &data, core::runtime::graphics::ShaderType type) override {
+            m_Bytecode.assign(data.begin(), data.end());
+            m_Type = type;
+            m_IsCompiled = !data.empty();
+            return m_IsCompiled;
+        }
+
+        std::span<unsigned char> GetCompiledShader() override {
+            return m_Bytecode;
+        }
+
+        core::runtime::graphics::ShaderCapsFlags GetImplCapabilities() const override {
+            return core::runtime::graphics::ShaderCapsFlags::SHADER_CAPS_ALLOW_PROVIDE_COMPILED;
+        }
+
+        std::string m_Source;
+        std::vector<unsigned char> m_Bytecode;
+        core::runtime::graphics::ShaderType m_Type = core::runtime::graphics::ShaderType::SHADER_TYPE_UNKNOWN;
+        bool m_IsCompiled = false;
+    };
+
+    struct D3D9NullShaderProgram : public core::runtime::graphics::IShaderProgram {
+        bool Link() override {
+            return true;
+        }
+
+        void Destroy() override {
+            m_Shaders.clear();
+        }
+
+        void Bind() override {}
+
+        void Unbind() override {}
+
+        void AddShader(std::unique_ptr<core::runtime::graphics::IShader> shader) override {
+            m_Shaders.push_back(std::move(shader));
+        }
+
+        void SetUniformMat4(std::string_view, const glm::mat4 &) override {}
+
+        void SetUniformI(std::string_view, int) override {}
+
+        std::string GetLinkLog() override {
+            return "";
+        }
+
+        bool IsLinked() override {
+            return !m_Shaders.empty();
+        }
+
+        std::vector<std::unique_ptr<core::runtime::graphics::IShader>> m_Shaders;
+    };
+
+    struct D3D9NullTexture : public core::runtime::graphics::ITexture {
+        bool Create(const core::runtime::graphics::Bitmap &bitmap) override {
+            m_Bitmap = bitmap;
+            return true;
+        }
+
+        void Destroy() override {
+            m_Bitmap = {};
+        }
+
+        core::runtime::graphics::Bitmap Download() override {
+            return m_Bitmap;
+        }
+
+        core::math::Vector2 GetSize() override {
+            return m_Bitmap.Size();
+        }
+
+        void Bind(int) override {}
+
+        void Unbind() override {}
+
+        core::runtime::graphics::Bitmap m_Bitmap;
+    };
+
+    bool D3D9NullBackend::Initialize() {
+        return true;
+    }
+
+    void D3D9NullBackend::Shutdown() {
+        m_ActiveFeatures = 0;
+    }
+
+    std::string D3D9NullBackend::GetName() const {
+        return "Null";
+    }
+
+    std::string D3D9NullBackend::GetIdentifier() const {
+        return "null";
+    }
+
+    void D3D9NullBackend::SetViewport(core::math::Vector2, core::math::Vector2) {}
+
+    void D3D9NullBackend::SetScissor(core::math::Vector2, core::math::Vector2) {}
+
+    void D3D9NullBackend::EnableFeatures(core::runtime::graphics::BackendFeature featuresMask) {
+        m_ActiveFeatures |= featuresMask;
+    }
+
+    void D3D9NullBackend::DisableFeatures(core::runtime::graphics::BackendFeature featuresMask) {
+        m_ActiveFeatures &= ~featuresMask;
+    }
+
+    core::runtime::graphics::BackendFeature D3D9NullBackend::GetActiveFeatures() {
+        return static_cast<core::runtime::graphics::BackendFeature>(m_ActiveFeatures);
+    }
+
+    void D3D9NullBackend::Clear(core::runtime::graphics::Color) {}
+
+    bool D3D9NullBackend::Clear(const D3D9ClearDesc &) {
+        return true;
+    }
+
+    void D3D9NullBackend::BeginFrame(const D3D9ClearDesc &) {}
+
+    void D3D9NullBackend::EndFrame() {}
+
+    std::unique_ptr<core::runtime::graphics::IVertexBuffer> D3D9NullBackend::CreateVertexBuffer() {
+        return std::make_unique<D3D9NullVertexBuffer>();
+    }
+
+    std::unique_ptr<core::runtime::graphics::IShader> D3D9NullBackend::CreateShader() {
+        return std::make_unique<D3D9NullShader>();
+    }
+
+    std::unique_ptr<core::runtime::graphics::IShaderProgram> D3D9NullBackend::CreateShaderProgram() {
+        return std::make_unique<D3D9NullShaderProgram>();
+    }
+
+    std::unique_ptr<core::runtime::graphics::ITexture> D3D9NullBackend::CreateTexture() {
+        return std::make_unique<D3D9NullTexture>();
+    }
+}
@@ -0,0 +1,172 @@
+#include <Engine/Backend/D3D9/D3D9_OcclusionQuery.hpp>
+#include <Engine/Runtime/Logger.hpp>
+
+#include <d3d9.h>
+
+namespace engine::backend::dx9 {
+    static runtime::Logger g_LoggerD3D9OcclusionQuery("D3D9OcclusionQuery");
+
+    bool D3D9OcclusionQueryPool::Create() {
+        if (!m_Device) {
+            g_LoggerD3D9OcclusionQuery.Log(runtime::LOG_LEVEL_ERROR, "Device is NULL.");
+            return false;
+        }
+
+        // passing NULL only checks whether the query type is supported
+        m_Supported = SUCCEEDED(m_Device->CreateQuery(D3DQUERYTYPE_OCCLUSION, nullptr));
+
+        if (!m_Supported) {
+            g_LoggerD3D9OcclusionQuery.Log(runtime::LOG_LEVEL_WARNING, "Occlusion queries are not supported; every object will be reported as visible.");
+        }
+
+        return m_Supported;
+    }
+
+    void D3D9OcclusionQueryPool::Destroy() {
+        // the active query is also part of the pending list, so it's released below
+        m_ActiveQuery = nullptr;
+
+        for (auto &pending: m_PendingQueries) {
+            pending.m_Query->Release();
+        }
+
+        for (auto query: m_FreeQueries) {
+            query->Release();
+        }
+
+        m_PendingQueries.clear();
+        m_FreeQueries.clear();
+
+        // results are meaningless without the queries that produced them
+        for (auto &[id, state]: m_Objects) {
+            state.m_QueryInFlight = false;
+            state.m_Visible = true;
+        }
+    }
+
+    void D3D9OcclusionQueryPool::BeginFrame() {
+        m_FrameIndex++;
+
+        for (size_t i = 0; i < m_PendingQueries.size();) {
+            auto &pending = m_PendingQueries[i];
+
+            DWORD pixels = 0;
+            // no D3DGETDATA_FLUSH: we never want to force the command buffer out just to poll
+            HRESULT hr = pending.m_Query->GetData(&pixels, sizeof(pixels), 0);
+
+            if (hr == S_FALSE) {
+                ++i;
+                continue;
+            }
+
+            // results of queries issued before the id was forgotten belong to an object that no longer exists
+            auto it = m_Objects.find(pending.m_ObjectId);
+            if (it != m_Objects.end() && it->second.m_Generation == pending.m_Generation) {
+                it->second.m_QueryInFlight = false;
+
+                if (hr == S_OK) {
+                    it->second.m_Visible = pixels > m_VisiblePixelThreshold;
+                    it->second.m_ResultFrame = m_FrameIndex;
+                } else {
+                    // D3DERR_DEVICELOST and friends; be conservative
+                    it->second.m_Visible = true;
+                }
+            }
+
+            RecycleQuery(pending.m_Query);
+
+            pending = m_PendingQueries.back();
+            m_PendingQueries.pop_back();
+        }
+    }
+
+    void D3D9OcclusionQueryPool::BeginProxyPass() {
+        m_Device->GetRenderState(D3DRS_COLORWRITEENABLE, &m_SavedColorWrite);
+        m_Device->GetRenderState(D3DRS_ZWRITEENABLE, &m_SavedZWrite);
+        m_Device->GetRenderState(D3DRS_ZENABLE, &m_SavedZEnable);
+
+        m_Device->SetRenderState(D3DRS_COLORWRITEENABLE, 0);
+        m_Device->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
+        m_Device->SetRenderState(D3DRS_ZENABLE, D3DZB_TRUE);
+    }
+
+    void D3D9OcclusionQueryPool::EndProxyPass() {
+        m_Device->SetRenderState(D3DRS_COLORWRITEENABLE, m_SavedColorWrite);
+        m_Device->SetRenderState(D3DRS_ZWRITEENABLE, m_SavedZWrite);
+        m_Device->SetRenderState(D3DRS_ZENABLE, m_SavedZEnable);
+    }
+
+    bool D3D9OcclusionQueryPool::BeginQuery(D3D9OcclusionObjectId id) {
+        if (!m_Supported || m_ActiveQuery) {
+            return false;
+        }
+
+        auto &state = m_Objects[id];
+        if (state.m_QueryInFlight) {
+            return false;
+        }
+
+        auto query = AcquireQuery();
+        if (!query) {
+            return false;
+        }
+
+        if (FAILED(query->Issue(D3DISSUE_BEGIN))) {
+            RecycleQuery(query);
+            return false;
+        }
+
+        state.m_QueryInFlight = true;
+        state.m_Generation = ++m_NextGeneration;
+        m_ActiveQuery = query;
+        m_PendingQueries.push_back({query, id, state.m_Generation});
+
+        return true;
+    }
+
+    void D3D9OcclusionQueryPool::EndQuery() {
+        if (!m_ActiveQuery) {
+            return;
+        }
+
+        m_ActiveQuery->Issue(D3DISSUE_END);
+        m_ActiveQuery = nullptr;
+    }
+
+    bool D3D9OcclusionQueryPool::IsVisible(D3D9OcclusionObjectId id) const {
+        auto it = m_Objects.find(id);
+        if (it == m_Objects.end() || it->second.m_Visible) {
+            return true;
+        }
+
+        // a stale "hidden" result is not trusted, the object may have moved into view since then
+        return m_FrameIndex - it->second.m_ResultFrame > m_MaxResultAge;
+    }
+
+    void D3D9OcclusionQueryPool::Forget(D3D9OcclusionObjectId id) {
+        // a query still in flight for this id will be recycled by BeginFrame once it resolves, its result is
+        // ignored as the generation no longer matches
+        m_Objects.erase(id);
+    }
+
+    IDirect3DQuery9 *D3D9OcclusionQueryPool::AcquireQuery() {
+        if (!m_FreeQueries.empty()) {
+            auto query = m_FreeQueries.back();
+            m_FreeQueries.pop_back();
+            return query;
+        }
+
+        IDirect3DQuery9 *query = nullptr;
+        HRESULT hr = m_Device->CreateQuery(D3DQUERYTYPE_OCCLUSION, &query);
+        if (FAILED(hr)) {
+            g_LoggerD3D9OcclusionQuery.Log(runtime::LOG_LEVEL_ERROR, "Failed to create occlusion query! Error: 0x%08x", hr);
+            return nullptr;
+        }
+
+        return query;
+    }
+
+    void D3D9OcclusionQueryPool::RecycleQuery(IDirect3DQuery9 *query) {
+        m_FreeQueries.push_back(query);
+    }
+}
@@ -0,0 +1,145 @@
+#include <Engine/Backend/D3D9/D3D9_RenderTargetPool.hpp>
+#include <Engine/Backend/D3D9/D3D9_TextureFormat.hpp>
+#include <Engine/Runtime/Logger.hpp>
+
+#include <d3d9.h>
+
+namespace engine::backend::dx9 {
+    static runtime::Logger g_LoggerD3D9RenderTargetPool("D3D9RenderTargetPool");
+
+    void D3D9RenderTargetPool::Destroy() {
+        for (auto &target: m_Targets) {
+            target.m_Texture->Destroy();
+        }
+
+        for (auto &surface: m_ReadbackSurfaces) {
+            surface.m_Surface->Release();
+        }
+
+        m_Targets.clear();
+        m_ReadbackSurfaces.clear();
+    }
+
+    void D3D9RenderTargetPool::BeginFrame() {
+        m_FrameIndex++;
+
+        for (size_t i = 0; i < m_Targets.size();) {
+            auto &target = m_Targets[i];
+            target.m_InUse = false;
+
+            if (m_FrameIndex - target.m_LastUsedFrame > m_MaxIdleFrames) {
+                g_LoggerD3D9RenderTargetPool.Log(runtime::LOG_LEVEL_DEBUG, "Freeing idle render target %ux%u.", target.m_Width, target.m_Height);
+
+                target.m_Texture->Destroy();
+                target = std::move(m_Targets.back());
+                m_Targets.pop_back();
+                continue;
+            }
+
+            ++i;
+        }
+
+        for (size_t i = 0; i < m_ReadbackSurfaces.size();) {
+            auto &surface = m_ReadbackSurfaces[i];
+
+            if (!surface.m_InUse && m_FrameIndex - surface.m_LastUsedFrame > m_MaxIdleFrames) {
+                surface.m_Surface->Release();
+                surface = m_ReadbackSurfaces.back();
+                m_ReadbackSurfaces.pop_back();
+                continue;
+            }
+
+            ++i;
+        }
+    }
+
+    D3D9Texture *D3D9RenderTargetPool::Acquire(uint32_t width, uint32_t height, D3D9TextureFormat format) {
+        for (auto &target: m_Targets) {
+            if (!target.m_InUse && target.m_Width == width && target.m_Height == height && target.m_Format == format) {
+                target.m_InUse = true;
+                target.m_LastUsedFrame = m_FrameIndex;
+                return target.m_Texture.get();
+            }
+        }
+
+        auto texture = std::make_unique<D3D9Texture>(m_Device, this, m_TextureBudget);
+        if (!texture->CreateRenderTarget(width, height, format)) {
+            return nullptr;
+        }
+
+        g_LoggerD3D9RenderTargetPool.Log(runtime::LOG_LEVEL_DEBUG, "Allocated transient render target %ux%u (%u in pool).", width, height, static_cast<unsigned int>(m_Targets.size() + 1));
+
+        auto result = texture.get();
+        m_Targets.push_back({std::move(texture), width, height, format, true, m_FrameIndex});
+
+        return result;
+    }
+
+    void D3D9RenderTargetPool::Release(D3D9Texture *texture) {
+        for (auto &target: m_Targets) {
+            if (target.m_Texture.get() == texture) {
+                target.m_InUse = false;
+                return;
+            }
+        }
+
+        g_LoggerD3D9RenderTargetPool.Log(runtime::LOG_LEVEL_WARNING, "Released a render target that isn't owned by this pool.");
+    }
+
+    IDirect3DSurface9 *D3D9RenderTargetPool::AcquireReadbackSurface(uint32_t width, uint32_t height, D3D9TextureFormat format) {
+        for (auto &surface: m_ReadbackSurfaces) {
+            if (!surface.m_InUse && surface.m_Width == width && surface.m_Height == height && surface.m_Format == format) {
+                surface.m_InUse = true;
+                surface.m_LastUsedFrame = m_FrameIndex;
+                return surface.m_Surface;
+            }
+        }
+
+        IDirect3DSurface9 *surface = nullptr;
+        HRESULT hr = m_Device->CreateOffscreenPlainSurface(width, height, D3D9_ConvertTextureFormat(format), D3DPOOL_SYSTEMMEM, &surface, nullptr);
+        if (FAILED(hr)) {
+            g_LoggerD3D9RenderTargetPool.Log(runtime::LOG_LEVEL_ERROR, "Failed to create readback surface! Error: 0x%08x", hr);
+            return nullptr;
+        }
+
+        m_ReadbackSurfaces.push_back({surface, width, height, format, true, m_FrameIndex});
+
+        return surface;
+    }
+
+    void D3D9RenderTargetPool::ReleaseReadbackSurface(IDirect3DSurface9 *surface) {
+        for (auto &pooled: m_ReadbackSurfaces) {
+            if (pooled.m_Surface == surface) {
+                pooled.m_InUse = false;
+                return;
+            }
+        }
+    }
+
+    void D3D9RenderTargetPool::OnDeviceLost() {
+        // readback surfaces live in system memory and survive the reset
+        for (auto &target: m_Targets) {
+            target.m_Texture->OnDeviceLost();
+        }
+    }
+
+    bool D3D9RenderTargetPool::OnDeviceReset() {
+        bool ret = true;
+
+        for (auto &target: m_Targets) {
+            ret &= target.m_Texture->OnDeviceReset();
+        }
+
+        return ret;
+    }
+
+    size_t D3D9RenderTargetPool::GetAllocatedBytes() const {
+        size_t total = 0;
+
+        for (auto &target: m_Targets) {
+            total += target.m_Texture->GetByteSize();
+        }
+
+        return total;
+    }
+}
@@ -0,0 +1,60 @@
+#include <Engine/Backend/D3D9/D3D9_ResourceRegistry.hpp>
+#include <Engine/Runtime/Logger.hpp>
+
+#include <chrono>
+#include <vector>
+
+namespace engine::backend::dx9 {
+    static runtime::Logger g_LoggerD3D9ResourceRegistry("D3D9ResourceRegistry");
+
+    D3D9ResourceRegistry::~D3D9ResourceRegistry() {
+        // resources may outlive the backend, they must not unregister through a dangling pointer later
+        std::vector<D3D9DeviceResource *> resources(m_Resources.begin(), m_Resources.end());
+        m_Resources.clear();
+
+        for (auto resource: resources) {
+            resource->OnRegistryDestroyed();
+        }
+    }
+
+    void D3D9ResourceRegistry::ReleaseAll() {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // resources may unregister others while releasing, so iterate over a snapshot
+        std::vector<D3D9DeviceResource *> resources(m_Resources.begin(), m_Resources.end());
+        for (auto resource: resources) {
+            resource->OnDeviceLost();
+        }
+
+        m_LastRecovery = {};
+        m_LastRecovery.m_ResourceCount = resources.size();
+        m_LastRecovery.m_ReleaseTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        g_LoggerD3D9ResourceRegistry.Log(runtime::LOG_LEVEL_INFO, "Released %u device resources in %.2f ms.", static_cast<unsigned int>(resources.size()), m_LastRecovery.m_ReleaseTimeMs);
+    }
+
+    bool D3D9ResourceRegistry::RestoreAll() {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::vector<D3D9DeviceResource *> resources(m_Resources.begin(), m_Resources.end());
+        size_t failed = 0;
+
+        for (auto resource: resources) {
+            if (!resource->OnDeviceReset()) {
+                failed++;
+            }
+        }
+
+        m_LastRecovery.m_ResourceCount = resources.size();
+        m_LastRecovery.m_FailedCount = failed;
+        m_LastRecovery.m_RestoreTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        if (failed > 0) {
+            g_LoggerD3D9ResourceRegistry.Log(runtime::LOG_LEVEL_ERROR, "Failed to restore %u of %u device resources!", static_cast<unsigned int>(failed), static_cast<unsigned int>(resources.size()));
+        }
+
+        g_LoggerD3D9ResourceRegistry.Log(runtime::LOG_LEVEL_INFO, "Restored %u device resources in %.2f ms.", static_cast<unsigned int>(resources.size() - failed), m_LastRecovery.m_RestoreTimeMs);
+
+        return failed == 0;
+    }
+}
@@ -3,6 +3,7 @@
 
 #include <d3d9.h>
 #include <d3dx9.h>
+#include <d3dcompiler.h>
 
 namespace engine::backend::dx9 {
     static runtime::Logger g_LoggerD3D9Shader("D3D9Shader");
@@ -18,12 +19,23 @@ namespace engine::backend::dx9 {
             m_CompiledShader = nullptr;
         }
 
+        if(m_ConstantTable) {
+            m_ConstantTable->Release();
+            m_ConstantTable = nullptr;
+        }
+
+        m_HasReflectedConstants = false;
+        m_ReflectedConstants = {};
+        m_ReflectedStrings = {};
+
         if(m_ShaderHandle) {
             if (m_ShaderType == core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX) {
                 reinterpret_cast<IDirect3DVertexShader9 *>(m_ShaderHandle)->Release();
             } else if (m_ShaderType == core::runtime::graphics::ShaderType::SHADER_TYPE_FRAGMENT) {
                 reinterpret_cast<IDirect3DPixelShader9 *>(m_ShaderHandle)->Release();
             }
+
+            m_ShaderHandle = nullptr;
         }
     }
 
@@ -42,7 +54,68 @@ namespace engine::backend::dx9 {
         }
     }
 
-    bool D3D9Shader::UseCompiledShader(const std::span<unsigned char> &data, core::runtime::graphics::ShaderType type) {
+    // the returned array points into `defines` and is terminated by a NULL entry, as D3DX and D3DCompile expect
+    template<typename Macro>
+    static std::vector<Macro> D3D9_BuildMacros(const D3D9ShaderDefines &defines) {
+        std::vector<Macro> macros;
+        macros.reserve(defines.size() + 1);
+
+        for (auto &[name, value]: defines) {
+            macros.push_back({name.c_str(), value.c_str()});
+        }
+
+        macros.push_back({nullptr, nullptr});
+        return macros;
+    }
+
+    bool D3D9_CompileShaderBytecode(
+            std::string_view source,
+            core::runtime::graphics::ShaderType type,
+            const D3D9ShaderDefines &defines,
+            std::vector<unsigned char> &bytecode,
+            std::string &log
+    ) {
+        // D3DX isn't documented as thread-safe, D3DCompile is; both produce the same SM3 bytecode and constant table
+        auto macros = D3D9_BuildMacros<D3D_SHADER_MACRO>(defines);
+
+        ID3DBlob *compiled = nullptr;
+        ID3DBlob *errors = nullptr;
+
+        HRESULT hr = D3DCompile(
+                source.data(),
+                source.size(),
+                nullptr,
+                macros.data(),
+                nullptr,
+                "main",
+                D3D9_GetProfile(type),
+                0,
+                0,
+                &compiled,
+                &errors
+        );
+
+        if (errors) {
+            log.assign(static_cast<const char *>(errors->GetBufferPointer()), errors->GetBufferSize());
+            errors->Release();
+        }
+
+        if (FAILED(hr)) {
+            if (compiled) {
+                compiled->Release();
+            }
+
+            return false;
+        }
+
+        auto data = static_cast<const unsigned char *>(compiled->GetBufferPointer());
+        bytecode.assign(data, data + compiled->GetBufferSize());
+        compiled->Release();
+
+        return true;
+    }
+
+    bool D3D9Shader::CreateShaderObject(const std::span<unsigned char> &data, core::runtime::graphics::ShaderType type) {
         if (data.empty()) {
             g_LoggerD3D9Shader.Log(runtime::LOG_LEVEL_ERROR, "Shader code is empty.");
             return false;
@@ -81,7 +154,114 @@ namespace engine::backend::dx9 {
         return true;
     }
 
+    bool D3D9Shader::UseCompiledShader(const std::span<unsigned char> &data, core::runtime::graphics::ShaderType type) {
+        if (!CreateShaderObject(data, type)) {
+            return false;
+        }
+
+        // precompiled bytecode carries its constant table as a comment block, so uniforms keep working
+        if (!m_ConstantTable) {
+            D3DXGetShaderConstantTable(reinterpret_cast<const DWORD*>(data.data()), &m_ConstantTable);
+        }
+
+        return true;
+    }
+
+    bool D3D9Shader::UseCompiledShader(
+            const std::span<unsigned char> &data,
+            core::runtime::graphics::ShaderType type,
+            std::span<const D3D9ShaderPackConstant> constants,
+            std::string_view strings
+    ) {
+        if (!CreateShaderObject(data, type)) {
+            return false;
+        }
+
+        m_HasReflectedConstants = true;
+        m_ReflectedConstants = constants;
+        m_ReflectedStrings = strings;
+
+        return true;
+    }
+
+    bool D3D9Shader::FindConstant(std::string_view name, D3D9ShaderConstantInfo &info) const {
+        if (m_HasReflectedConstants) {
+            // the pack validated every name against its string table when it was opened
+            for (auto &constant: m_ReflectedConstants) {
+                if (m_ReflectedStrings.substr(constant.m_NameOffset, constant.m_NameLength) == name) {
+                    info = {constant.m_RegisterSet, constant.m_RegisterIndex, constant.m_RegisterCount, constant.m_Class};
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        if (!m_ConstantTable) {
+            return false;
+        }
+
+        // D3DX wants a NUL terminated name
+        std::string key(name);
+
+        D3DXHANDLE handle = m_ConstantTable->GetConstantByName(nullptr, key.c_str());
+        if (!handle) {
+            return false;
+        }
+
+        D3DXCONSTANT_DESC desc;
+        UINT count = 1;
+        if (FAILED(m_ConstantTable->GetConstantDesc(handle, &desc, &count)) || count == 0) {
+            return false;
+        }
+
+        info.m_RegisterSet = desc.RegisterSet;
+        info.m_RegisterIndex = desc.RegisterIndex;
+        info.m_RegisterCount = desc.RegisterCount;
+        info.m_Class = desc.Class;
+
+        return true;
+    }
+
+    bool D3D9Shader::UseSharedShader(const D3D9Shader &shader) {
+        if (!shader.m_ShaderHandle) {
+            g_LoggerD3D9Shader.Log(runtime::LOG_LEVEL_ERROR, "Cannot share a shader that has no shader object.");
+            return false;
+        }
+
+        Destroy();
+
+        m_ShaderType = shader.m_ShaderType;
+        m_ShaderHandle = shader.m_ShaderHandle;
+
+        if (m_ShaderType == core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX) {
+            reinterpret_cast<IDirect3DVertexShader9 *>(m_ShaderHandle)->AddRef();
+        } else {
+            reinterpret_cast<IDirect3DPixelShader9 *>(m_ShaderHandle)->AddRef();
+        }
+
+        m_CompiledShader = shader.m_CompiledShader;
+        if (m_CompiledShader) {
+            m_CompiledShader->AddRef();
+        }
+
+        m_ConstantTable = shader.m_ConstantTable;
+        if (m_ConstantTable) {
+            m_ConstantTable->AddRef();
+        }
+
+        m_HasReflectedConstants = shader.m_HasReflectedConstants;
+        m_ReflectedConstants = shader.m_ReflectedConstants;
+        m_ReflectedStrings = shader.m_ReflectedStrings;
+
+        return true;
+    }
+
     std::span<unsigned char> D3D9Shader::GetCompiledShader() {
+        if (!m_CompiledShader) {
+            return {};
+        }
+
         return {
             (unsigned char *) m_CompiledShader->GetBufferPointer(),
             m_CompiledShader->GetBufferSize()
@@ -99,10 +279,12 @@ namespace engine::backend::dx9 {
             Destroy();
         }
 
+        auto macros = D3D9_BuildMacros<D3DXMACRO>(m_Defines);
+
         HRESULT hr = D3DXCompileShader(
                 m_SourceCode.c_str(),
                 static_cast<UINT>(m_SourceCode.size()),
-                nullptr,
+                macros.data(),
                 nullptr,
                 "main",
                 D3D9_GetProfile(m_ShaderType),
@@ -0,0 +1,318 @@
+#include <Engine/Backend/D3D9/D3D9_ShaderConstants.hpp>
+#include <Engine/Runtime/Logger.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <d3d9.h>
+
+namespace engine::backend::dx9 {
+    static runtime::Logger g_LoggerD3D9ShaderConstants("D3D9ShaderConstants");
+
+    static bool D3D9_TestRegisterBit(const std::vector<uint64_t> &mask, uint32_t index) {
+        return (mask[index / 64] >> (index % 64)) & 1;
+    }
+
+    static char D3D9_GetRegisterPrefix(D3D9ConstantRegisterSet registerSet) {
+        switch (registerSet) {
+            case CONSTANT_REGISTER_SET_INT4:
+                return 'i';
+            case CONSTANT_REGISTER_SET_BOOL:
+                return 'b';
+            default:
+                return 'c';
+        }
+    }
+
+    D3D9ConstantRegisterFile::D3D9ConstantRegisterFile(
+            core::runtime::graphics::ShaderType stage,
+            uint32_t registerCount,
+            D3D9ConstantRegisterSet registerSet
+    ) :
+            m_Stage(stage),
+            m_RegisterSet(registerSet),
+            m_RegisterCount(registerCount),
+            m_RegisterWords(registerSet == CONSTANT_REGISTER_SET_BOOL ? 1 : 4),
+            m_Registers(registerCount * m_RegisterWords, 0),
+            m_DirtyMask((registerCount + 63) / 64, 0),
+            m_WrittenMask((registerCount + 63) / 64, 0) {}
+
+    bool D3D9ConstantRegisterFile::Write(uint32_t firstRegister, const float *data, uint32_t registerCount) {
+        if (m_RegisterSet != CONSTANT_REGISTER_SET_FLOAT4) {
+            g_LoggerD3D9ShaderConstants.Log(runtime::LOG_LEVEL_ERROR, "Float data written to %c%u, which is not a float4 register.", D3D9_GetRegisterPrefix(m_RegisterSet), firstRegister);
+            return false;
+        }
+
+        return WriteWords(firstRegister, data, registerCount);
+    }
+
+    bool D3D9ConstantRegisterFile::Write(uint32_t firstRegister, const int *data, uint32_t registerCount) {
+        if (m_RegisterSet == CONSTANT_REGISTER_SET_FLOAT4) {
+            g_LoggerD3D9ShaderConstants.Log(runtime::LOG_LEVEL_ERROR, "Integer data written to float4 register c%u.", firstRegister);
+            return false;
+        }
+
+        return WriteWords(firstRegister, data, registerCount);
+    }
+
+    bool D3D9ConstantRegisterFile::WriteWords(uint32_t firstRegister, const void *data, uint32_t registerCount) {
+        const char prefix = D3D9_GetRegisterPrefix(m_RegisterSet);
+
+        if (firstRegister >= m_RegisterCount || registerCount > m_RegisterCount - firstRegister) {
+            g_LoggerD3D9ShaderConstants.Log(runtime::LOG_LEVEL_ERROR, "Constant registers %c%u-%c%u are out of range.", prefix, firstRegister, prefix, firstRegister + registerCount - 1);
+            return false;
+        }
+
+        const size_t registerSize = sizeof(uint32_t) * m_RegisterWords;
+        auto *shadow = reinterpret_cast<char *>(&m_Registers[firstRegister * m_RegisterWords]);
+        auto *source = static_cast<const char *>(data);
+        bool changed = false;
+
+        // only registers whose value changes become dirty
+        for (uint32_t i = 0; i < registerCount; ++i) {
+            uint32_t index = firstRegister + i;
+
+            if (D3D9_TestRegisterBit(m_WrittenMask, index) && memcmp(shadow + i * registerSize, source + i * registerSize, registerSize) == 0) {
+                continue;
+            }
+
+            memcpy(shadow + i * registerSize, source + i * registerSize, registerSize);
+            MarkDirty(index, 1);
+            changed = true;
+        }
+
+        return changed;
+    }
+
+    void D3D9ConstantRegisterFile::MarkDirty(uint32_t firstRegister, uint32_t registerCount) {
+        for (uint32_t index = firstRegister; index < firstRegister + registerCount; ++index) {
+            m_DirtyMask[index / 64] |= uint64_t(1) << (index % 64);
+            m_WrittenMask[index / 64] |= uint64_t(1) << (index % 64);
+        }
+
+        m_HasDirty = true;
+    }
+
+    void D3D9ConstantRegisterFile::Flush(IDirect3DDevice9 *device, D3D9ShaderConstantStats &stats) {
+        if (!m_HasDirty) {
+            return;
+        }
+
+        uint32_t index = 0;
+
+        while (index < m_RegisterCount) {
+            if (!D3D9_TestRegisterBit(m_DirtyMask, index)) {
+                index++;
+                continue;
+            }
+
+            uint32_t first = index;
+            uint32_t last = index;
+
+            // extend the run over dirty registers and over short gaps of registers that hold known values
+            for (uint32_t next = index + 1; next < m_RegisterCount; ++next) {
+                if (D3D9_TestRegisterBit(m_DirtyMask, next)) {
+                    last = next;
+                } else if (next - last > MAX_MERGE_GAP || !D3D9_TestRegisterBit(m_WrittenMask, next)) {
+                    break;
+                }
+            }
+
+            const void *data = &m_Registers[first * m_RegisterWords];
+            const uint32_t count = last - first + 1;
+            const bool vertex = m_Stage == core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX;
+            HRESULT hr;
+
+            switch (m_RegisterSet) {
+                case CONSTANT_REGISTER_SET_INT4:
+                    hr = vertex ? device->SetVertexShaderConstantI(first, static_cast<const int *>(data), count) :
+                         device->SetPixelShaderConstantI(first, static_cast<const int *>(data), count);
+                    break;
+                case CONSTANT_REGISTER_SET_BOOL:
+                    hr = vertex ? device->SetVertexShaderConstantB(first, static_cast<const BOOL *>(data), count) :
+                         device->SetPixelShaderConstantB(first, static_cast<const BOOL *>(data), count);
+                    break;
+                default:
+                    hr = vertex ? device->SetVertexShaderConstantF(first, static_cast<const float *>(data), count) :
+                         device->SetPixelShaderConstantF(first, static_cast<const float *>(data), count);
+                    break;
+            }
+
+            if (FAILED(hr)) {
+                const char prefix = D3D9_GetRegisterPrefix(m_RegisterSet);
+                g_LoggerD3D9ShaderConstants.Log(runtime::LOG_LEVEL_ERROR, "Failed to upload shader constants %c%u-%c%u! Error: 0x%08x", prefix, first, prefix, last, hr);
+            }
+
+            stats.m_UploadCalls++;
+            stats.m_RegistersUploaded += count;
+
+            index = last + 1;
+        }
+
+        std::fill(m_DirtyMask.begin(), m_DirtyMask.end(), 0);
+        m_HasDirty = false;
+    }
+
+    void D3D9ConstantRegisterFile::Invalidate() {
+        m_DirtyMask = m_WrittenMask;
+        m_HasDirty = std::any_of(m_DirtyMask.begin(), m_DirtyMask.end(), [](uint64_t word) { return word != 0; });
+    }
+
+    D3D9UniformBlock::D3D9UniformBlock(uint32_t stages, uint32_t baseRegister, uint32_t registerCount) :
+            m_Stages(stages),
+            m_BaseRegister(baseRegister),
+            m_RegisterCount(registerCount),
+            m_Data(registerCount * 4, 0.0f) {}
+
+    bool D3D9UniformBlock::CheckRange(uint32_t offset, uint32_t registerCount) const {
+        if (offset >= m_RegisterCount || registerCount > m_RegisterCount - offset) {
+            g_LoggerD3D9ShaderConstants.Log(runtime::LOG_LEVEL_ERROR, "Uniform block offset %u is out of range.", offset);
+            return false;
+        }
+
+        return true;
+    }
+
+    void D3D9UniformBlock::SetMat4(uint32_t offset, const glm::mat4 &value) {
+        if (!CheckRange(offset, 4)) return;
+
+        // column_major packing puts one matrix row into each register
+        float *data = &m_Data[offset * 4];
+        for (int row = 0; row < 4; ++row) {
+            for (int column = 0; column < 4; ++column) {
+                data[row * 4 + column] = value[column][row];
+            }
+        }
+
+        m_Version++;
+    }
+
+    void D3D9UniformBlock::SetVec4(uint32_t offset, const glm::vec4 &value) {
+        const float values[4] = {value[0], value[1], value[2], value[3]};
+        SetFloat4(offset, values, 1);
+    }
+
+    void D3D9UniformBlock::SetFloat4(uint32_t offset, const float *values, uint32_t registerCount) {
+        if (!CheckRange(offset, registerCount)) return;
+
+        memcpy(&m_Data[offset * 4], values, registerCount * 4 * sizeof(float));
+        m_Version++;
+    }
+
+    void D3D9UniformBlock::SetFloat(uint32_t offset, float value) {
+        const float values[4] = {value, 0.0f, 0.0f, 0.0f};
+        SetFloat4(offset, values, 1);
+    }
+
+    void D3D9UniformBlock::SetInt(uint32_t offset, int value) {
+        // integers declared as int/float in HLSL live in float registers as well
+        SetFloat(offset, static_cast<float>(value));
+    }
+
+    D3D9ShaderConstants::D3D9ShaderConstants() :
+            m_VertexRegisters(core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX, VERTEX_REGISTER_COUNT),
+            m_FragmentRegisters(core::runtime::graphics::ShaderType::SHADER_TYPE_FRAGMENT, FRAGMENT_REGISTER_COUNT),
+            m_VertexIntRegisters(core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX, INT_REGISTER_COUNT, CONSTANT_REGISTER_SET_INT4),
+            m_FragmentIntRegisters(core::runtime::graphics::ShaderType::SHADER_TYPE_FRAGMENT, INT_REGISTER_COUNT, CONSTANT_REGISTER_SET_INT4),
+            m_VertexBoolRegisters(core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX, BOOL_REGISTER_COUNT, CONSTANT_REGISTER_SET_BOOL),
+            m_FragmentBoolRegisters(core::runtime::graphics::ShaderType::SHADER_TYPE_FRAGMENT, BOOL_REGISTER_COUNT, CONSTANT_REGISTER_SET_BOOL) {}
+
+    void D3D9ShaderConstants::BindBlock(D3D9UniformBlock *block) {
+        if (!block) return;
+
+        for (auto &binding: m_Blocks) {
+            if (binding.m_Block == block) {
+                return;
+            }
+        }
+
+        // version 0 is never used by a block, so the first flush always commits it
+        m_Blocks.push_back({block, 0});
+    }
+
+    void D3D9ShaderConstants::UnbindBlock(D3D9UniformBlock *block) {
+        std::erase_if(m_Blocks, [block](const BlockBinding &binding) {
+            return binding.m_Block == block;
+        });
+    }
+
+    void D3D9ShaderConstants::Write(core::runtime::graphics::ShaderType stage, uint32_t firstRegister, const float *data, uint32_t registerCount) {
+        bool changed = false;
+
+        if (stage == core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX) {
+            changed = m_VertexRegisters.Write(firstRegister, data, registerCount);
+        } else if (stage == core::runtime::graphics::ShaderType::SHADER_TYPE_FRAGMENT) {
+            changed = m_FragmentRegisters.Write(firstRegister, data, registerCount);
+        }
+
+        CountWrite(changed);
+    }
+
+    void D3D9ShaderConstants::WriteInt(core::runtime::graphics::ShaderType stage, uint32_t firstRegister, const int *data, uint32_t registerCount) {
+        bool changed = false;
+
+        if (stage == core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX) {
+            changed = m_VertexIntRegisters.Write(firstRegister, data, registerCount);
+        } else if (stage == core::runtime::graphics::ShaderType::SHADER_TYPE_FRAGMENT) {
+            changed = m_FragmentIntRegisters.Write(firstRegister, data, registerCount);
+        }
+
+        CountWrite(changed);
+    }
+
+    void D3D9ShaderConstants::WriteBool(core::runtime::graphics::ShaderType stage, uint32_t firstRegister, const int *data, uint32_t registerCount) {
+        bool changed = false;
+
+        if (stage == core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX) {
+            changed = m_VertexBoolRegisters.Write(firstRegister, data, registerCount);
+        } else if (stage == core::runtime::graphics::ShaderType::SHADER_TYPE_FRAGMENT) {
+            changed = m_FragmentBoolRegisters.Write(firstRegister, data, registerCount);
+        }
+
+        CountWrite(changed);
+    }
+
+    void D3D9ShaderConstants::CountWrite(bool changed) {
+        if (!changed) {
+            m_Stats.m_RedundantWrites++;
+        }
+    }
+
+    void D3D9ShaderConstants::Flush(IDirect3DDevice9 *device) {
+        if (!device) return;
+
+        for (auto &binding: m_Blocks) {
+            auto block = binding.m_Block;
+            if (binding.m_CommittedVersion == block->GetVersion()) {
+                continue;
+            }
+
+            if (block->GetStages() & UNIFORM_STAGE_VERTEX) {
+                m_VertexRegisters.Write(block->GetBaseRegister(), block->GetData(), block->GetRegisterCount());
+            }
+
+            if (block->GetStages() & UNIFORM_STAGE_FRAGMENT) {
+                m_FragmentRegisters.Write(block->GetBaseRegister(), block->GetData(), block->GetRegisterCount());
+            }
+
+            binding.m_CommittedVersion = block->GetVersion();
+        }
+
+        m_Stats.m_Flushes++;
+        m_VertexRegisters.Flush(device, m_Stats);
+        m_FragmentRegisters.Flush(device, m_Stats);
+        m_VertexIntRegisters.Flush(device, m_Stats);
+        m_FragmentIntRegisters.Flush(device, m_Stats);
+        m_VertexBoolRegisters.Flush(device, m_Stats);
+        m_FragmentBoolRegisters.Flush(device, m_Stats);
+    }
+
+    void D3D9ShaderConstants::Invalidate() {
+        m_VertexRegisters.Invalidate();
+        m_FragmentRegisters.Invalidate();
+        m_VertexIntRegisters.Invalidate();
+        m_FragmentIntRegisters.Invalidate();
+        m_VertexBoolRegisters.Invalidate();
+        m_FragmentBoolRegisters.Invalidate();
+    }
+}
@@ -0,0 +1,338 @@
+#include <Engine/Backend/D3D9/D3D9_ShaderPack.hpp>
+#include <Engine/Runtime/Logger.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace engine::backend::dx9 {
+    static runtime::Logger g_LoggerD3D9ShaderPack("D3D9ShaderPack");
+
+    uint64_t D3D9_HashShaderName(std::string_view name) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+
+        for (char c: name) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001b3ull;
+        }
+
+        return hash;
+    }
+
+    bool D3D9ShaderPack::Open(const std::string &path) {
+        Close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            g_LoggerD3D9ShaderPack.Log(runtime::LOG_LEVEL_ERROR, "Failed to open shader pack '%s'.", path.c_str());
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+        if (!view) {
+            g_LoggerD3D9ShaderPack.Log(runtime::LOG_LEVEL_ERROR, "Failed to map shader pack '%s'.", path.c_str());
+
+            if (mapping) {
+                CloseHandle(mapping);
+            }
+
+            CloseHandle(file);
+            return false;
+        }
+
+        m_FileHandle = reinterpret_cast<intptr_t>(file);
+        m_MappingHandle = reinterpret_cast<intptr_t>(mapping);
+        m_MappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            g_LoggerD3D9ShaderPack.Log(runtime::LOG_LEVEL_ERROR, "Failed to open shader pack '%s'.", path.c_str());
+            return false;
+        }
+
+        struct stat fileStat{};
+        if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0) {
+            close(file);
+            return false;
+        }
+
+        void *view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (view == MAP_FAILED) {
+            g_LoggerD3D9ShaderPack.Log(runtime::LOG_LEVEL_ERROR, "Failed to map shader pack '%s'.", path.c_str());
+            close(file);
+            return false;
+        }
+
+        m_FileHandle = file;
+        m_MappedSize = static_cast<size_t>(fileStat.st_size);
+#endif
+
+        m_MappedView = view;
+        m_Data = {static_cast<const unsigned char *>(view), m_MappedSize};
+
+        if (!Validate()) {
+            g_LoggerD3D9ShaderPack.Log(runtime::LOG_LEVEL_ERROR, "'%s' is not a valid shader pack.", path.c_str());
+            Close();
+            return false;
+        }
+
+        g_LoggerD3D9ShaderPack.Log(runtime::LOG_LEVEL_INFO, "Mapped shader pack '%s' with %u shaders.", path.c_str(), m_Header->m_EntryCount);
+        return true;
+    }
+
+    bool D3D9ShaderPack::OpenFromMemory(std::span<const unsigned char> data) {
+        Close();
+
+        m_Data = data;
+
+        if (!Validate()) {
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void D3D9ShaderPack::Close() {
+        if (m_MappedView) {
+#ifdef _WIN32
+            UnmapViewOfFile(m_MappedView);
+            CloseHandle(reinterpret_cast<HANDLE>(m_MappingHandle));
+            CloseHandle(reinterpret_cast<HANDLE>(m_FileHandle));
+#else
+            munmap(m_MappedView, m_MappedSize);
+            close(static_cast<int>(m_FileHandle));
+#endif
+        }
+
+        m_MappedView = nullptr;
+        m_MappedSize = 0;
+        m_FileHandle = -1;
+        m_MappingHandle = -1;
+
+        m_Data = {};
+        m_Header = nullptr;
+    }
+
+    bool D3D9ShaderPack::Validate() {
+        if (m_Data.size() < sizeof(D3D9ShaderPackHeader)) {
+            return false;
+        }
+
+        auto header = reinterpret_cast<const D3D9ShaderPackHeader *>(m_Data.data());
+        if (header->m_Magic != D3D9_SHADER_PACK_MAGIC || header->m_Version != D3D9_SHADER_PACK_VERSION) {
+            return false;
+        }
+
+        // check every range once here so lookups can trust the offsets
+        auto inBounds = [this](uint64_t offset, uint64_t size) {
+            return offset <= m_Data.size() && size <= m_Data.size() - offset;
+        };
+
+        uint64_t entriesEnd = sizeof(D3D9ShaderPackHeader) + static_cast<uint64_t>(header->m_EntryCount) * sizeof(D3D9ShaderPackEntry);
+        uint64_t constantsSize = static_cast<uint64_t>(header->m_ConstantCount) * sizeof(D3D9ShaderPackConstant);
+
+        if (!inBounds(0, entriesEnd) || !inBounds(entriesEnd, constantsSize) ||
+            !inBounds(header->m_StringTableOffset, header->m_StringTableSize)) {
+            return false;
+        }
+
+        m_Header = header;
+
+        const D3D9ShaderPackEntry *previous = nullptr;
+
+        for (auto &entry: GetEntries()) {
+            if (!inBounds(entry.m_BytecodeOffset, entry.m_BytecodeSize) || (entry.m_BytecodeOffset % 4) != 0 ||
+                static_cast<uint64_t>(entry.m_FirstConstant) + entry.m_ConstantCount > header->m_ConstantCount ||
+                static_cast<uint64_t>(entry.m_NameOffset) + entry.m_NameLength > header->m_StringTableSize) {
+                m_Header = nullptr;
+                return false;
+            }
+
+            if (entry.m_Stage != SHADER_PACK_STAGE_VERTEX && entry.m_Stage != SHADER_PACK_STAGE_FRAGMENT) {
+                m_Header = nullptr;
+                return false;
+            }
+
+            // Find binary searches the hashes, so they have to be sorted and match the names
+            if ((previous && previous->m_NameHash > entry.m_NameHash) || D3D9_HashShaderName(GetName(entry)) != entry.m_NameHash) {
+                m_Header = nullptr;
+                return false;
+            }
+
+            previous = &entry;
+
+            for (auto &constant: GetConstants(entry)) {
+                if (static_cast<uint64_t>(constant.m_NameOffset) + constant.m_NameLength > header->m_StringTableSize) {
+                    m_Header = nullptr;
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    const D3D9ShaderPackEntry *D3D9ShaderPack::Find(std::string_view name) const {
+        if (!m_Header) {
+            return nullptr;
+        }
+
+        auto entries = GetEntries();
+        uint64_t hash = D3D9_HashShaderName(name);
+
+        auto it = std::lower_bound(entries.begin(), entries.end(), hash, [](const D3D9ShaderPackEntry &entry, uint64_t value) {
+            return entry.m_NameHash < value;
+        });
+
+        for (; it != entries.end() && it->m_NameHash == hash; ++it) {
+            if (GetName(*it) == name) {
+                return &*it;
+            }
+        }
+
+        return nullptr;
+    }
+
+    std::span<const D3D9ShaderPackEntry> D3D9ShaderPack::GetEntries() const {
+        if (!m_Header) {
+            return {};
+        }
+
+        return {reinterpret_cast<const D3D9ShaderPackEntry *>(m_Data.data() + sizeof(D3D9ShaderPackHeader)), m_Header->m_EntryCount};
+    }
+
+    std::span<const unsigned char> D3D9ShaderPack::GetBytecode(const D3D9ShaderPackEntry &entry) const {
+        return m_Data.subspan(entry.m_BytecodeOffset, entry.m_BytecodeSize);
+    }
+
+    std::span<const D3D9ShaderPackConstant> D3D9ShaderPack::GetConstants(const D3D9ShaderPackEntry &entry) const {
+        auto constants = reinterpret_cast<const D3D9ShaderPackConstant *>(
+                m_Data.data() + sizeof(D3D9ShaderPackHeader) + m_Header->m_EntryCount * sizeof(D3D9ShaderPackEntry)
+        );
+
+        return {constants + entry.m_FirstConstant, entry.m_ConstantCount};
+    }
+
+    std::string_view D3D9ShaderPack::GetString(uint32_t offset, uint32_t length) const {
+        return {reinterpret_cast<const char *>(m_Data.data() + m_Header->m_StringTableOffset + offset), length};
+    }
+
+    std::string_view D3D9ShaderPack::GetStringTable() const {
+        return {reinterpret_cast<const char *>(m_Data.data() + m_Header->m_StringTableOffset), m_Header->m_StringTableSize};
+    }
+
+    void D3D9ShaderPackWriter::AddShader(std::string_view name, D3D9ShaderPackStage stage, std::span<const unsigned char> bytecode, std::vector<Constant> constants) {
+        m_Shaders.push_back({
+                std::string(name),
+                stage,
+                {bytecode.begin(), bytecode.end()},
+                std::move(constants)
+        });
+    }
+
+    std::vector<unsigned char> D3D9ShaderPackWriter::Serialize() const {
+        std::vector<const Shader *> shaders;
+        for (auto &shader: m_Shaders) {
+            shaders.push_back(&shader);
+        }
+
+        std::stable_sort(shaders.begin(), shaders.end(), [](const Shader *a, const Shader *b) {
+            return D3D9_HashShaderName(a->m_Name) < D3D9_HashShaderName(b->m_Name);
+        });
+
+        std::vector<D3D9ShaderPackEntry> entries;
+        std::vector<D3D9ShaderPackConstant> constants;
+        std::string strings;
+
+        for (auto shader: shaders) {
+            D3D9ShaderPackEntry entry{};
+            entry.m_NameHash = D3D9_HashShaderName(shader->m_Name);
+            entry.m_NameOffset = static_cast<uint32_t>(strings.size());
+            entry.m_NameLength = static_cast<uint32_t>(shader->m_Name.size());
+            entry.m_Stage = shader->m_Stage;
+            entry.m_BytecodeSize = static_cast<uint32_t>(shader->m_Bytecode.size());
+            entry.m_FirstConstant = static_cast<uint32_t>(constants.size());
+            entry.m_ConstantCount = static_cast<uint32_t>(shader->m_Constants.size());
+
+            strings += shader->m_Name;
+
+            for (auto &constant: shader->m_Constants) {
+                constants.push_back({
+                        static_cast<uint32_t>(strings.size()),
+                        static_cast<uint32_t>(constant.m_Name.size()),
+                        constant.m_RegisterSet,
+                        constant.m_RegisterIndex,
+                        constant.m_RegisterCount,
+                        constant.m_Class
+                });
+
+                strings += constant.m_Name;
+            }
+
+            entries.push_back(entry);
+        }
+
+        D3D9ShaderPackHeader header{};
+        header.m_Magic = D3D9_SHADER_PACK_MAGIC;
+        header.m_Version = D3D9_SHADER_PACK_VERSION;
+        header.m_EntryCount = static_cast<uint32_t>(entries.size());
+        header.m_ConstantCount = static_cast<uint32_t>(constants.size());
+        header.m_StringTableOffset = static_cast<uint32_t>(
+                sizeof(D3D9ShaderPackHeader) + entries.size() * sizeof(D3D9ShaderPackEntry) + constants.size() * sizeof(D3D9ShaderPackConstant)
+        );
+        header.m_StringTableSize = static_cast<uint32_t>(strings.size());
+
+        // bytecode goes last, each blob aligned to a DWORD
+        size_t offset = (header.m_StringTableOffset + strings.size() + 3) & ~static_cast<size_t>(3);
+        for (size_t i = 0; i < shaders.size(); ++i) {
+            entries[i].m_BytecodeOffset = static_cast<uint32_t>(offset);
+            offset = (offset + shaders[i]->m_Bytecode.size() + 3) & ~static_cast<size_t>(3);
+        }
+
+        std::vector<unsigned char> data(offset, 0);
+        memcpy(data.data(), &header, sizeof(header));
+        memcpy(data.data() + sizeof(header), entries.data(), entries.size() * sizeof(D3D9ShaderPackEntry));
+        memcpy(data.data() + sizeof(header) + entries.size() * sizeof(D3D9ShaderPackEntry), constants.data(), constants.size() * sizeof(D3D9ShaderPackConstant));
+        memcpy(data.data() + header.m_StringTableOffset, strings.data(), strings.size());
+
+        for (size_t i = 0; i < shaders.size(); ++i) {
+            memcpy(data.data() + entries[i].m_BytecodeOffset, shaders[i]->m_Bytecode.data(), shaders[i]->m_Bytecode.size());
+        }
+
+        return data;
+    }
+
+    bool D3D9ShaderPackWriter::Write(const std::string &path) const {
+        auto data = Serialize();
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            g_LoggerD3D9ShaderPack.Log(runtime::LOG_LEVEL_ERROR, "Failed to open '%s' for writing.", path.c_str());
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        return file.good();
+    }
+}
@@ -3,12 +3,21 @@
 #include <Engine/Runtime/Logger.hpp>
 #include <Engine/Core/Runtime/Graphics/IShader.hpp>
 
+#include <algorithm>
+
 #include <d3d9.h>
 #include <d3dx9.h>
 
 namespace engine::backend::dx9 {
     static runtime::Logger g_LoggerD3D9ShaderProgram("D3D9ShaderProgram");
 
+    static D3D9Shader *D3D9_GetCompiledShader(const std::unique_ptr<core::runtime::graphics::IShader> &shader) {
+        auto dxShader = dynamic_cast<D3D9Shader*>(shader.get());
+        if (!dxShader || !dxShader->IsCompiled()) return nullptr;
+
+        return dxShader;
+    }
+
     bool D3D9ShaderProgram::Link() {
         bool ret = true;
 
@@ -22,6 +31,8 @@ namespace engine::backend::dx9 {
             ret &= m_VertexShader->Compile();
         }
 
+        m_UniformLocations.clear();
+
         if(ret) {
             g_LoggerD3D9ShaderProgram.Log(runtime::LOG_LEVEL_INFO, "Shader program linked successfully!");
         } else {
@@ -70,6 +81,7 @@ namespace engine::backend::dx9 {
 
         // try to check type by dynamically casting to D3D9Shader before
         auto dxShader = dynamic_cast<D3D9Shader*>(shader.get());
+        m_UniformLocations.clear();
 
         if (dxShader) {
             if (dxShader->GetShaderType() == core::runtime::graphics::ShaderType::SHADER_TYPE_FRAGMENT) {
@@ -84,27 +96,121 @@ namespace engine::backend::dx9 {
         }
     }
 
+    const D3D9ShaderProgram::UniformLocations &D3D9ShaderProgram::GetUniformLocations(std::string_view name) {
+        auto it = m_UniformLocations.find(name);
+        if (it != m_UniformLocations.end()) {
+            return it->second;
+        }
+
+        // pack shaders answer from the packer's reflection, compiled ones from their constant table
+        auto resolve = [&](const std::unique_ptr<core::runtime::graphics::IShader> &shader, UniformLocation &location) {
+            auto dxShader = D3D9_GetCompiledShader(shader);
+            if (!dxShader) return;
+
+            D3D9ShaderConstantInfo info;
+            if (!dxShader->FindConstant(name, info) || info.m_RegisterSet == D3DXRS_SAMPLER) return;
+
+            location.m_IsValid = true;
+            location.m_IsRowMajor = info.m_Class == D3DXPC_MATRIX_ROWS;
+            location.m_RegisterSet = info.m_RegisterSet;
+            location.m_Register = info.m_RegisterIndex;
+            location.m_RegisterCount = info.m_RegisterCount;
+        };
+
+        UniformLocations locations;
+        resolve(m_VertexShader, locations.m_Vertex);
+        resolve(m_FragmentShader, locations.m_Fragment);
+
+        return m_UniformLocations.emplace(std::string(name), locations).first->second;
+    }
+
+    void D3D9ShaderProgram::WriteUniform(
+            core::runtime::graphics::ShaderType stage,
+            const UniformLocation &location,
+            const float *data,
+            uint32_t registerCount
+    ) {
+        if (location.m_RegisterSet != D3DXRS_FLOAT4) return;
+
+        // smaller types (float4x3, float) only occupy part of the registers
+        registerCount = std::min(registerCount, location.m_RegisterCount);
+
+        if (m_ShaderConstants) {
+            m_ShaderConstants->Write(stage, location.m_Register, data, registerCount);
+        } else if (stage == core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX) {
+            m_Device->SetVertexShaderConstantF(location.m_Register, data, registerCount);
+        } else {
+            m_Device->SetPixelShaderConstantF(location.m_Register, data, registerCount);
+        }
+    }
+
+    void D3D9ShaderProgram::WriteUniform(core::runtime::graphics::ShaderType stage, const UniformLocation &location, int value) {
+        bool vertex = stage == core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX;
+
+        switch (location.m_RegisterSet) {
+            case D3DXRS_FLOAT4: {
+                const float registers[4] = {static_cast<float>(value), 0.0f, 0.0f, 0.0f};
+                WriteUniform(stage, location, registers, 1);
+                break;
+            }
+            case D3DXRS_INT4: {
+                const int registers[4] = {value, 0, 0, 0};
+                if (m_ShaderConstants) {
+                    m_ShaderConstants->WriteInt(stage, location.m_Register, registers, 1);
+                } else if (vertex) {
+                    m_Device->SetVertexShaderConstantI(location.m_Register, registers, 1);
+                } else {
+                    m_Device->SetPixelShaderConstantI(location.m_Register, registers, 1);
+                }
+                break;
+            }
+            case D3DXRS_BOOL: {
+                const BOOL flag = value != 0;
+                if (m_ShaderConstants) {
+                    m_ShaderConstants->WriteBool(stage, location.m_Register, &flag, 1);
+                } else if (vertex) {
+                    m_Device->SetVertexShaderConstantB(location.m_Register, &flag, 1);
+                } else {
+                    m_Device->SetPixelShaderConstantB(location.m_Register, &flag, 1);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
     void D3D9ShaderProgram::SetUniformMat4(std::string_view name, const glm::mat4 &mat) {
-        // check type and if it's compiled
-        auto vShader = dynamic_cast<D3D9Shader*>(m_VertexShader.get());
-        if (!vShader && !vShader->IsCompiled()) return;
+        auto &locations = GetUniformLocations(name);
+
+        auto write = [&](core::runtime::graphics::ShaderType stage, const UniformLocation &location) {
+            if (!location.m_IsValid) return;
 
-        // get uniform (also known as constant in DX world)
-        D3DXHANDLE handle = vShader->GetConstantTable()->GetConstantByName(nullptr, name.data());
-        if (!handle) return;
+            // same layout D3DX uses: column_major matrices hold one row per register, row_major ones one column
+            float registers[16];
+            for (int r = 0; r < 4; ++r) {
+                for (int c = 0; c < 4; ++c) {
+                    registers[r * 4 + c] = location.m_IsRowMajor ? mat[r][c] : mat[c][r];
+                }
+            }
 
-        // set matrix value
-        vShader->GetConstantTable()->SetMatrix(m_Device, handle, (D3DXMATRIX*)&mat);
+            WriteUniform(stage, location, registers, 4);
+        };
+
+        write(core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX, locations.m_Vertex);
+        write(core::runtime::graphics::ShaderType::SHADER_TYPE_FRAGMENT, locations.m_Fragment);
     }
 
     void D3D9ShaderProgram::SetUniformI(std::string_view name, int val) {
-        auto vShader = dynamic_cast<D3D9Shader*>(m_VertexShader.get());
-        if (!vShader && !vShader->IsCompiled()) return;
+        auto &locations = GetUniformLocations(name);
 
-        D3DXHANDLE handle = vShader->GetConstantTable()->GetConstantByName(nullptr, name.data());
-        if (!handle) return;
+        if (locations.m_Vertex.m_IsValid) {
+            WriteUniform(core::runtime::graphics::ShaderType::SHADER_TYPE_VERTEX, locations.m_Vertex, val);
+        }
 
-        vShader->GetConstantTable()->SetInt(m_Device, handle, val);
+        if (locations.m_Fragment.m_IsValid) {
+            WriteUniform(core::runtime::graphics::ShaderType::SHADER_TYPE_FRAGMENT, locations.m_Fragment, val);
+        }
     }
 
     std::string D3D9ShaderProgram::GetLinkLog() {
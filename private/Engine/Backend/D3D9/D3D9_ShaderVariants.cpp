@@ -0,0 +1,304 @@
+#include <Engine/Backend/D3D9/D3D9_ShaderVariants.hpp>
+#include <Engine/Backend/D3D9/D3D9_Shader.hpp>
+#include <Engine/Runtime/Logger.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace engine::backend::dx9 {
+    static runtime::Logger g_LoggerD3D9ShaderVariants("D3D9ShaderVariants");
+
+    // Compile workers shared by every variant set. Prewarming many variants (or many sets) queues the compiles and
+    // runs at most hardware_concurrency() - 1 of them at once, leaving a core for the render thread.
+    struct D3D9ShaderCompileQueue {
+        static D3D9ShaderCompileQueue &Get() {
+            static D3D9ShaderCompileQueue queue;
+            return queue;
+        }
+
+        // only a fallback, joining threads during static destruction is not safe everywhere (e.g. on DLL unload)
+        ~D3D9ShaderCompileQueue() {
+            Shutdown();
+        }
+
+        void Push(const void *owner, D3D9ShaderKeywordMask mask, std::packaged_task<void()> task) {
+            {
+                std::lock_guard lock(m_Mutex);
+                m_Jobs.push_back({owner, mask, std::move(task)});
+
+                // workers are started on demand, when the idle ones can't take every queued job, and stay around
+                // for later prewarms
+                if (m_Jobs.size() > m_IdleWorkers && m_Workers.size() < GetWorkerLimit()) {
+                    m_Workers.emplace_back(&D3D9ShaderCompileQueue::RunWorker, this);
+                }
+            }
+
+            m_Condition.notify_one();
+        }
+
+        // Stops and joins the workers once they finish their current job. Queued jobs stay queued: CreateVariant
+        // still runs them itself, and the next Push starts new workers.
+        void Shutdown() {
+            std::vector<std::thread> workers;
+
+            {
+                std::lock_guard lock(m_Mutex);
+                m_Stopping = true;
+                workers = std::move(m_Workers);
+                m_Workers.clear();
+            }
+
+            m_Condition.notify_all();
+
+            for (auto &worker: workers) {
+                worker.join();
+            }
+
+            std::lock_guard lock(m_Mutex);
+            m_Stopping = false;
+        }
+
+        // removes a job no worker has started yet, so a caller that needs the result right away can run it itself
+        std::packaged_task<void()> Take(const void *owner, D3D9ShaderKeywordMask mask) {
+            std::lock_guard lock(m_Mutex);
+
+            for (auto it = m_Jobs.begin(); it != m_Jobs.end(); ++it) {
+                if (it->m_Owner == owner && it->m_Mask == mask) {
+                    auto task = std::move(it->m_Task);
+                    m_Jobs.erase(it);
+                    return task;
+                }
+            }
+
+            return {};
+        }
+
+        // drops the owner's jobs that haven't started; their futures become ready with a broken promise
+        void Cancel(const void *owner) {
+            std::deque<Job> cancelled;
+
+            {
+                std::lock_guard lock(m_Mutex);
+
+                for (auto it = m_Jobs.begin(); it != m_Jobs.end();) {
+                    if (it->m_Owner == owner) {
+                        cancelled.push_back(std::move(*it));
+                        it = m_Jobs.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+        }
+
+    protected:
+        struct Job {
+            const void *m_Owner;
+            D3D9ShaderKeywordMask m_Mask;
+            std::packaged_task<void()> m_Task;
+        };
+
+        static size_t GetWorkerLimit() {
+            unsigned int cores = std::thread::hardware_concurrency();
+            return cores > 2 ? cores - 1 : 1;
+        }
+
+        void RunWorker() {
+            for (;;) {
+                std::packaged_task<void()> task;
+
+                {
+                    std::unique_lock lock(m_Mutex);
+
+                    m_IdleWorkers++;
+                    m_Condition.wait(lock, [this] { return m_Stopping || !m_Jobs.empty(); });
+                    m_IdleWorkers--;
+
+                    if (m_Stopping) {
+                        return;
+                    }
+
+                    task = std::move(m_Jobs.front().m_Task);
+                    m_Jobs.pop_front();
+                }
+
+                task();
+            }
+        }
+
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::deque<Job> m_Jobs;
+        std::vector<std::thread> m_Workers;
+        size_t m_IdleWorkers = 0;
+        bool m_Stopping = false;
+    };
+
+    void D3D9_ShutdownShaderCompileWorkers() {
+        D3D9ShaderCompileQueue::Get().Shutdown();
+    }
+
+    D3D9ShaderVariantSet::D3D9ShaderVariantSet(IDirect3DDevice9 *device,
+                                               std::string source,
+                                               core::runtime::graphics::ShaderType type,
+                                               std::vector<std::string> keywords) :
+            m_Device(device),
+            m_Source(std::move(source)),
+            m_Type(type),
+            m_Keywords(std::move(keywords)) {
+        if (m_Keywords.size() > MAX_KEYWORDS) {
+            g_LoggerD3D9ShaderVariants.Log(runtime::LOG_LEVEL_WARNING, "Only the first %u shader keywords are usable.", static_cast<unsigned int>(MAX_KEYWORDS));
+            m_Keywords.resize(MAX_KEYWORDS);
+        }
+    }
+
+    D3D9ShaderVariantSet::~D3D9ShaderVariantSet() {
+        // background compiles reference our source and keywords: queued ones are dropped, running ones have to finish
+        D3D9ShaderCompileQueue::Get().Cancel(this);
+
+        for (auto &[mask, variant]: m_Variants) {
+            if (variant.m_Result.valid() && variant.m_Result.wait_for(std::chrono::seconds(0)) != std::future_status::deferred) {
+                variant.m_Result.wait();
+            }
+
+            // D3D9Shader doesn't release on destruction; shaders handed out keep their own references
+            if (variant.m_Shader) {
+                variant.m_Shader->Destroy();
+            }
+        }
+    }
+
+    D3D9ShaderKeywordMask D3D9ShaderVariantSet::GetKeywordMask(std::string_view keyword) const {
+        for (size_t i = 0; i < m_Keywords.size(); ++i) {
+            if (m_Keywords[i] == keyword) {
+                return D3D9ShaderKeywordMask(1) << i;
+            }
+        }
+
+        g_LoggerD3D9ShaderVariants.Log(runtime::LOG_LEVEL_WARNING, "Unknown shader keyword '%.*s'.", static_cast<int>(keyword.size()), keyword.data());
+        return 0;
+    }
+
+    std::unique_ptr<core::runtime::graphics::IShader> D3D9ShaderVariantSet::CreateVariant(D3D9ShaderKeywordMask mask) {
+        auto it = m_Variants.find(mask);
+
+        if (it != m_Variants.end()) {
+            m_Hits++;
+
+            // a prewarmed variant still waiting in the queue is compiled here instead of waiting for a worker
+            if (it->second.m_Result.wait_for(std::chrono::seconds(0)) == std::future_status::timeout) {
+                auto task = D3D9ShaderCompileQueue::Get().Take(this, mask);
+                if (task.valid()) {
+                    task();
+                }
+            }
+        } else {
+            m_Misses++;
+
+            Variant variant;
+            variant.m_Result = std::async(std::launch::deferred, &D3D9ShaderVariantSet::CompileVariant, this, mask).share();
+            it = m_Variants.emplace(mask, std::move(variant)).first;
+        }
+
+        auto &variant = it->second;
+        auto &result = ResolveVariant(variant);
+        if (!result.m_Success) {
+            return nullptr;
+        }
+
+        if (!variant.m_Shader) {
+            auto shader = std::make_unique<D3D9Shader>(m_Device);
+
+            // the device copies the bytecode, the cached copy is never modified
+            std::span<unsigned char> bytecode(const_cast<unsigned char *>(result.m_Bytecode.data()), result.m_Bytecode.size());
+            if (!shader->UseCompiledShader(bytecode, m_Type)) {
+                return nullptr;
+            }
+
+            variant.m_Shader = std::move(shader);
+        }
+
+        auto shader = std::make_unique<D3D9Shader>(m_Device);
+        if (!shader->UseSharedShader(*variant.m_Shader)) {
+            return nullptr;
+        }
+
+        return shader;
+    }
+
+    void D3D9ShaderVariantSet::Prewarm(std::span<const D3D9ShaderKeywordMask> masks) {
+        for (auto mask: masks) {
+            if (m_Variants.contains(mask)) {
+                continue;
+            }
+
+            std::packaged_task<CompileResult()> compile([this, mask] { return CompileVariant(mask); });
+
+            Variant variant;
+            variant.m_Result = compile.get_future().share();
+            m_Variants.emplace(mask, std::move(variant));
+
+            D3D9ShaderCompileQueue::Get().Push(this, mask, std::packaged_task<void()>([compile = std::move(compile)]() mutable {
+                compile();
+            }));
+        }
+    }
+
+    D3D9ShaderVariantStats D3D9ShaderVariantSet::GetStats() const {
+        D3D9ShaderVariantStats stats{};
+        stats.m_Hits = m_Hits;
+        stats.m_Misses = m_Misses;
+        stats.m_Compiles = m_Compiles;
+        stats.m_Failures = m_Failures;
+        stats.m_CompileTimeMs = m_CompileTimeMs;
+        stats.m_VariantCount = m_Variants.size();
+
+        for (auto &[mask, variant]: m_Variants) {
+            if (variant.m_Accounted) {
+                stats.m_BytecodeBytes += variant.m_Result.get().m_Bytecode.size();
+            }
+        }
+
+        return stats;
+    }
+
+    D3D9ShaderVariantSet::CompileResult D3D9ShaderVariantSet::CompileVariant(D3D9ShaderKeywordMask mask) const {
+        D3D9ShaderDefines defines;
+
+        for (size_t i = 0; i < m_Keywords.size(); ++i) {
+            if (mask & (D3D9ShaderKeywordMask(1) << i)) {
+                defines.emplace_back(m_Keywords[i], "1");
+            }
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        CompileResult result{};
+        result.m_Success = D3D9_CompileShaderBytecode(m_Source, m_Type, defines, result.m_Bytecode, result.m_Log);
+        result.m_CompileTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        return result;
+    }
+
+    const D3D9ShaderVariantSet::CompileResult &D3D9ShaderVariantSet::ResolveVariant(Variant &variant) {
+        auto &result = variant.m_Result.get();
+
+        // stats are only touched here, on the calling thread
+        if (!variant.m_Accounted) {
+            variant.m_Accounted = true;
+            m_Compiles++;
+            m_CompileTimeMs += result.m_CompileTimeMs;
+
+            if (!result.m_Success) {
+                m_Failures++;
+                g_LoggerD3D9ShaderVariants.Log(runtime::LOG_LEVEL_ERROR, "Failed to compile shader variant!");
+                g_LoggerD3D9ShaderVariants.Log(runtime::LOG_LEVEL_ERROR, "%s", result.m_Log.c_str());
+            }
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,325 @@
+#include <Engine/Backend/D3D9/D3D9_SpriteBatch.hpp>
+#include <Engine/Backend/D3D9/D3D9_VertexDeclaration.hpp>
+#include <Engine/Runtime/Logger.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <d3d9.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define D3D9_SPRITE_BATCH_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace engine::backend::dx9 {
+    static runtime::Logger g_LoggerD3D9SpriteBatch("D3D9SpriteBatch");
+
+    D3D9SpriteBatch::D3D9SpriteBatch(
+            IDirect3DDevice9 *device,
+            D3D9ResourceRegistry *resourceRegistry,
+            size_t maxQuads,
+            D3D9ShaderConstants *shaderConstants
+    ) :
+            m_Device(device),
+            m_ResourceRegistry(resourceRegistry),
+            m_ShaderConstants(shaderConstants),
+            m_MaxQuads(std::clamp<size_t>(maxQuads, 1, MAX_QUADS)) {}
+
+    D3D9SpriteBatch::~D3D9SpriteBatch() {
+        Destroy();
+    }
+
+    bool D3D9SpriteBatch::Create() {
+        if (!m_Device) {
+            g_LoggerD3D9SpriteBatch.Log(runtime::LOG_LEVEL_ERROR, "Device is NULL.");
+            return false;
+        }
+
+        m_Staging.reserve(m_MaxQuads * 4);
+
+        if (!CreateDeviceBuffers()) {
+            return false;
+        }
+
+        if (m_ResourceRegistry) {
+            m_ResourceRegistry->Register(this);
+        }
+
+        return true;
+    }
+
+    void D3D9SpriteBatch::Destroy() {
+        if (m_ResourceRegistry) {
+            m_ResourceRegistry->Unregister(this);
+        }
+
+        ReleaseDeviceBuffers();
+
+        m_Staging.clear();
+        m_QueuedQuads = 0;
+    }
+
+    bool D3D9SpriteBatch::CreateDeviceBuffers() {
+        HRESULT hr = m_Device->CreateVertexBuffer(
+                static_cast<UINT>(m_MaxQuads * 4 * sizeof(SpriteVertex)),
+                D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
+                0,
+                D3DPOOL_DEFAULT,
+                &m_VertexBuffer,
+                nullptr
+        );
+
+        if (FAILED(hr)) {
+            g_LoggerD3D9SpriteBatch.Log(runtime::LOG_LEVEL_ERROR, "Failed to create sprite vertex buffer! Error: 0x%08x", hr);
+            m_VertexBuffer = nullptr;
+            return false;
+        }
+
+        hr = m_Device->CreateIndexBuffer(
+                static_cast<UINT>(m_MaxQuads * 6 * sizeof(uint16_t)),
+                D3DUSAGE_WRITEONLY,
+                D3DFMT_INDEX16,
+                D3DPOOL_DEFAULT,
+                &m_IndexBuffer,
+                nullptr
+        );
+
+        if (FAILED(hr)) {
+            g_LoggerD3D9SpriteBatch.Log(runtime::LOG_LEVEL_ERROR, "Failed to create sprite index buffer! Error: 0x%08x", hr);
+            m_IndexBuffer = nullptr;
+            ReleaseDeviceBuffers();
+            return false;
+        }
+
+        // every quad uses the same two triangles, so the index buffer is filled once
+        uint16_t *indices;
+        hr = m_IndexBuffer->Lock(0, 0, reinterpret_cast<void **>(&indices), 0);
+        if (FAILED(hr)) {
+            g_LoggerD3D9SpriteBatch.Log(runtime::LOG_LEVEL_ERROR, "Failed to lock sprite index buffer! Error: 0x%08x", hr);
+            ReleaseDeviceBuffers();
+            return false;
+        }
+
+        for (size_t quad = 0; quad < m_MaxQuads; ++quad) {
+            auto base = static_cast<uint16_t>(quad * 4);
+
+            indices[quad * 6 + 0] = base;
+            indices[quad * 6 + 1] = base + 1;
+            indices[quad * 6 + 2] = base + 2;
+            indices[quad * 6 + 3] = base;
+            indices[quad * 6 + 4] = base + 2;
+            indices[quad * 6 + 5] = base + 3;
+        }
+
+        m_IndexBuffer->Unlock();
+        m_BufferCursor = 0;
+
+        return true;
+    }
+
+    void D3D9SpriteBatch::ReleaseDeviceBuffers() {
+        if (m_VertexBuffer) {
+            m_VertexBuffer->Release();
+            m_VertexBuffer = nullptr;
+        }
+
+        if (m_IndexBuffer) {
+            m_IndexBuffer->Release();
+            m_IndexBuffer = nullptr;
+        }
+    }
+
+    void D3D9SpriteBatch::SetProgram(core::runtime::graphics::IShaderProgram *program) {
+        if (program != m_Program) {
+            Flush();
+            m_Program = program;
+        }
+    }
+
+    void D3D9SpriteBatch::SetTexture(core::runtime::graphics::ITexture *texture) {
+        if (texture != m_Texture) {
+            Flush();
+            m_Texture = texture;
+        }
+    }
+
+    void D3D9SpriteBatch::SetScissor(core::math::Vector2 start, core::math::Vector2 size) {
+        ScissorRect scissor{
+                static_cast<long>(start.x),
+                static_cast<long>(start.y),
+                static_cast<long>(start.x + size.x),
+                static_cast<long>(start.y + size.y)
+        };
+
+        if (!m_HasScissor || !(scissor == m_Scissor)) {
+            Flush();
+            m_Scissor = scissor;
+            m_HasScissor = true;
+        }
+    }
+
+    void D3D9SpriteBatch::DrawQuad(
+            core::math::Vector2 position,
+            core::math::Vector2 size,
+            core::math::Vector2 uvMin,
+            core::math::Vector2 uvMax,
+            core::runtime::graphics::Color color,
+            float depth
+    ) {
+        if (m_QueuedQuads == m_MaxQuads) {
+            Flush();
+        }
+
+        size_t first = m_Staging.size();
+        m_Staging.resize(first + 4);
+
+        SpriteVertex *vertices = m_Staging.data() + first;
+        uint32_t packedColor = D3DCOLOR_ARGB(color.a, color.r, color.g, color.b);
+
+        float x0 = position.x, x1 = position.x + size.x;
+        float y0 = position.y, y1 = position.y + size.y;
+
+#ifdef D3D9_SPRITE_BATCH_SSE
+        // corners in order (x0, y0), (x1, y0), (x1, y1), (x0, y1); transposing turns the per-component
+        // registers into the first 4 and the next 4 floats of each vertex
+        __m128 xs = _mm_setr_ps(x0, x1, x1, x0);
+        __m128 ys = _mm_setr_ps(y0, y0, y1, y1);
+        __m128 zs = _mm_set1_ps(depth);
+        __m128 us = _mm_setr_ps(uvMin.x, uvMax.x, uvMax.x, uvMin.x);
+        _MM_TRANSPOSE4_PS(xs, ys, zs, us);
+
+        __m128 vs = _mm_setr_ps(uvMin.y, uvMin.y, uvMax.y, uvMax.y);
+        __m128 nxs = _mm_setzero_ps();
+        __m128 nys = _mm_setzero_ps();
+        __m128 nzs = _mm_set1_ps(-1.0f);
+        _MM_TRANSPOSE4_PS(vs, nxs, nys, nzs);
+
+        __m128 head[4] = {xs, ys, zs, us};
+        __m128 tail[4] = {vs, nxs, nys, nzs};
+
+        for (int i = 0; i < 4; ++i) {
+            auto floats = reinterpret_cast<float *>(&vertices[i]);
+            _mm_storeu_ps(floats, head[i]);
+            _mm_storeu_ps(floats + 4, tail[i]);
+            vertices[i].m_Color = packedColor;
+        }
+#else
+        const float corners[4][4] = {
+                {x0, y0, uvMin.x, uvMin.y},
+                {x1, y0, uvMax.x, uvMin.y},
+                {x1, y1, uvMax.x, uvMax.y},
+                {x0, y1, uvMin.x, uvMax.y}
+        };
+
+        for (int i = 0; i < 4; ++i) {
+            vertices[i] = {
+                    {corners[i][0], corners[i][1], depth},
+                    {corners[i][2], corners[i][3]},
+                    {0.0f, 0.0f, -1.0f},
+                    packedColor
+            };
+        }
+#endif
+
+        m_QueuedQuads++;
+    }
+
+    void D3D9SpriteBatch::Flush() {
+        if (m_QueuedQuads == 0) {
+            return;
+        }
+
+        if (!m_VertexBuffer || !m_IndexBuffer) {
+            // device lost or not created; drop the quads instead of growing the queue forever
+            m_Staging.clear();
+            m_QueuedQuads = 0;
+            return;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // append while the buffer has room, start over with a discard once it's full
+        DWORD lockFlags = D3DLOCK_NOOVERWRITE;
+        if (m_BufferCursor == 0 || m_BufferCursor + m_QueuedQuads > m_MaxQuads) {
+            m_BufferCursor = 0;
+            lockFlags = D3DLOCK_DISCARD;
+        }
+
+        const UINT vertexOffset = static_cast<UINT>(m_BufferCursor * 4 * sizeof(SpriteVertex));
+        const UINT vertexBytes = static_cast<UINT>(m_Staging.size() * sizeof(SpriteVertex));
+
+        void *data;
+        HRESULT hr = m_VertexBuffer->Lock(vertexOffset, vertexBytes, &data, lockFlags);
+        if (FAILED(hr)) {
+            g_LoggerD3D9SpriteBatch.Log(runtime::LOG_LEVEL_ERROR, "Failed to lock sprite vertex buffer! Error: 0x%08x", hr);
+            m_Staging.clear();
+            m_QueuedQuads = 0;
+            return;
+        }
+
+        memcpy(data, m_Staging.data(), vertexBytes);
+        m_VertexBuffer->Unlock();
+
+        if (m_Program) {
+            m_Program->Bind();
+        }
+
+        if (m_Texture) {
+            m_Texture->Bind(0);
+        } else {
+            m_Device->SetTexture(0, nullptr);
+        }
+
+        if (m_HasScissor) {
+            RECT scissorRect{m_Scissor.m_Left, m_Scissor.m_Top, m_Scissor.m_Right, m_Scissor.m_Bottom};
+            m_Device->SetScissorRect(&scissorRect);
+        }
+
+        m_Device->SetVertexDeclaration(D3D9_GetVertexDeclaration(m_Device));
+        m_Device->SetStreamSource(0, m_VertexBuffer, 0, sizeof(SpriteVertex));
+        m_Device->SetIndices(m_IndexBuffer);
+
+        if (m_ShaderConstants) {
+            m_ShaderConstants->Flush(m_Device);
+        }
+
+        hr = m_Device->DrawIndexedPrimitive(
+                D3DPT_TRIANGLELIST,
+                static_cast<INT>(m_BufferCursor * 4),
+                0,
+                static_cast<UINT>(m_QueuedQuads * 4),
+                0,
+                static_cast<UINT>(m_QueuedQuads * 2)
+        );
+
+        if (FAILED(hr)) {
+            g_LoggerD3D9SpriteBatch.Log(runtime::LOG_LEVEL_ERROR, "Failed to draw sprite batch. Error: 0x%08x", hr);
+        }
+
+        m_FrameStats.m_Quads += m_QueuedQuads;
+        m_FrameStats.m_DrawCalls++;
+
+        m_BufferCursor += m_QueuedQuads;
+        m_Staging.clear();
+        m_QueuedQuads = 0;
+
+        m_FrameStats.m_CpuTimeMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    void D3D9SpriteBatch::BeginFrame() {
+        Flush();
+
+        m_LastFrameStats = m_FrameStats;
+        m_FrameStats = {};
+    }
+
+    void D3D9SpriteBatch::OnDeviceLost() {
+        ReleaseDeviceBuffers();
+    }
+
+    bool D3D9SpriteBatch::OnDeviceReset() {
+        return CreateDeviceBuffers();
+    }
+}
@@ -1,4 +1,7 @@
 #include <Engine/Backend/D3D9/D3D9_Texture.hpp>
+#include <Engine/Backend/D3D9/D3D9_TextureFormat.hpp>
+#include <Engine/Backend/D3D9/D3D9_RenderTargetPool.hpp>
+#include <Engine/Backend/D3D9/D3D9_TextureBudget.hpp>
 #include <Engine/Runtime/Logger.hpp>
 
 #include <d3d9.h>
@@ -7,6 +10,77 @@
 namespace engine::backend::dx9 {
     static runtime::Logger g_LoggerD3D9Texture("D3D9Texture");
 
+    D3DFORMAT D3D9_ConvertTextureFormat(D3D9TextureFormat format) {
+        switch (format) {
+            default:
+            case D3D9TextureFormat::TEXTURE_FORMAT_RGBA8:
+                return D3DFMT_A8R8G8B8;
+            case D3D9TextureFormat::TEXTURE_FORMAT_RGBA16F:
+                return D3DFMT_A16B16G16R16F;
+            case D3D9TextureFormat::TEXTURE_FORMAT_R32F:
+                return D3DFMT_R32F;
+            case D3D9TextureFormat::TEXTURE_FORMAT_D24S8:
+                return D3DFMT_D24S8;
+        }
+    }
+
+    uint32_t D3D9_GetTextureFormatPixelSize(D3D9TextureFormat format) {
+        switch (format) {
+            case D3D9TextureFormat::TEXTURE_FORMAT_RGBA16F:
+                return 8;
+            default:
+                return 4;
+        }
+    }
+
+    // converts locked A8R8G8B8 rows back into engine colors
+    static void D3D9_ReadPixels(const D3DLOCKED_RECT &lockedRect, size_t width, size_t height, std::vector<core::runtime::graphics::Color> &pixels) {
+        pixels.resize(width * height);
+
+        for (size_t y = 0; y < height; ++y) {
+            auto src = reinterpret_cast<const D3DCOLOR *>(static_cast<const uint8_t *>(lockedRect.pBits) + y * lockedRect.Pitch);
+
+            for (size_t x = 0; x < width; ++x) {
+                D3DCOLOR pixel = src[x];
+                pixels[y * width + x] = {
+                        static_cast<uint8_t>((pixel >> 16) & 0xFF),
+                        static_cast<uint8_t>((pixel >> 8) & 0xFF),
+                        static_cast<uint8_t>(pixel & 0xFF),
+                        static_cast<uint8_t>((pixel >> 24) & 0xFF)
+                };
+            }
+        }
+    }
+
+    // copies A8R8G8B8 pixels into level 0 of a lockable texture
+    static bool D3D9_WritePixels(IDirect3DTexture9 *texture, const std::vector<uint32_t> &pixels, size_t width, size_t height) {
+        D3DLOCKED_RECT lockedRect;
+        if (FAILED(texture->LockRect(0, &lockedRect, nullptr, 0))) {
+            return false;
+        }
+
+        for (size_t y = 0; y < height; ++y) {
+            memcpy(
+                    static_cast<uint8_t *>(lockedRect.pBits) + y * lockedRect.Pitch,
+                    pixels.data() + y * width,
+                    width * sizeof(uint32_t)
+            );
+        }
+
+        texture->UnlockRect(0);
+        return true;
+    }
+
+    D3D9Texture::~D3D9Texture() {
+        if (m_TextureBudget) {
+            m_TextureBudget->Unregister(this);
+        }
+
+        if (m_ResourceRegistry) {
+            m_ResourceRegistry->Unregister(this);
+        }
+    }
+
     bool D3D9Texture::Create(const core::runtime::graphics::Bitmap &bitmap) {
         g_LoggerD3D9Texture.Log(runtime::LOG_LEVEL_DEBUG, "Creating texture %ix%i...", (unsigned int) bitmap.Size().x, (unsigned int) bitmap.Size().y);
 
@@ -14,33 +88,224 @@ namespace engine::backend::dx9 {
             return false;
         }
 
-        HRESULT hr = m_Device->CreateTexture(bitmap.Size().x, bitmap.Size().y, 1, D3DUSAGE_DYNAMIC, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &m_Texture, nullptr);
+        if (m_Texture || m_Surface) {
+            Destroy();
+        }
+
+        m_Width = static_cast<uint32_t>(bitmap.Size().x);
+        m_Height = static_cast<uint32_t>(bitmap.Size().y);
+        m_Format = D3D9TextureFormat::TEXTURE_FORMAT_RGBA8;
+        m_IsRenderTarget = false;
+        m_ByteSize = static_cast<size_t>(m_Width) * m_Height * 4;
+
+        // convert once into the device layout; evictable textures keep this copy to restore themselves later
+        const auto &pixels = bitmap.GetPixels();
+        m_SourcePixels.resize(static_cast<size_t>(m_Width) * m_Height);
+
+        for (size_t i = 0; i < m_SourcePixels.size(); ++i) {
+            const auto &color = pixels[i];
+            m_SourcePixels[i] = D3DCOLOR_ARGB(color.a, color.r, color.g, color.b);
+        }
+
+        m_IsManaged = !m_TextureBudget || !m_TextureBudget->IsEnabled();
+
+        // managed textures are still accounted for by the budget, they just never get evicted
+        if (m_TextureBudget) {
+            m_TextureBudget->Register(this);
+            m_LastUsedFrame = m_TextureBudget->GetFrameIndex();
+        }
+
+        if (m_ResourceRegistry && !m_IsManaged) {
+            m_ResourceRegistry->Register(this);
+        }
+
+        bool ret = Restore();
+
+        if (m_IsManaged) {
+            m_SourcePixels.clear();
+            m_SourcePixels.shrink_to_fit();
+        }
+
+        if (ret) {
+            g_LoggerD3D9Texture.Log(runtime::LOG_LEVEL_INFO, "Texture created and uploaded successfully!");
+        }
+
+        return ret;
+    }
+
+    bool D3D9Texture::Restore() {
+        if (m_Texture) {
+            return true;
+        }
+
+        if (m_SourcePixels.empty()) {
+            return false;
+        }
+
+        if (m_TextureBudget) {
+            m_TextureBudget->Reserve(m_ByteSize, this);
+        }
+
+        // evictable textures are plain (not dynamic) video memory textures, which works on every device
+        const D3DPOOL pool = m_IsManaged ? D3DPOOL_MANAGED : D3DPOOL_DEFAULT;
+
+        HRESULT hr = m_Device->CreateTexture(m_Width, m_Height, 1, 0, D3DFMT_A8R8G8B8, pool, &m_Texture, nullptr);
+
+        // the driver ran out of memory before our budget did, so free what we can and retry once
+        if ((hr == D3DERR_OUTOFVIDEOMEMORY || hr == E_OUTOFMEMORY) && m_TextureBudget && m_TextureBudget->Evict(m_ByteSize, this) > 0) {
+            hr = m_Device->CreateTexture(m_Width, m_Height, 1, 0, D3DFMT_A8R8G8B8, pool, &m_Texture, nullptr);
+        }
+
         if (FAILED(hr)) {
             g_LoggerD3D9Texture.Log(runtime::LOG_LEVEL_ERROR, "Failed to create texture. Error: 0x%08x", hr);
+            m_Texture = nullptr;
             return false;
         }
 
-        D3DLOCKED_RECT lockedRect;
-        if (SUCCEEDED(m_Texture->LockRect(0, &lockedRect, nullptr, 0))) {
-            uint8_t *dst = static_cast<uint8_t *>(lockedRect.pBits);
+        bool uploaded;
+
+        if (m_IsManaged) {
+            uploaded = D3D9_WritePixels(m_Texture, m_SourcePixels, m_Width, m_Height);
+        } else {
+            // D3DPOOL_DEFAULT textures aren't lockable, the pixels go through a system memory staging texture
+            IDirect3DTexture9 *staging = nullptr;
+            hr = m_Device->CreateTexture(m_Width, m_Height, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_SYSTEMMEM, &staging, nullptr);
 
-            auto pixels = bitmap.GetPixels();
+            uploaded = SUCCEEDED(hr) &&
+                       D3D9_WritePixels(staging, m_SourcePixels, m_Width, m_Height) &&
+                       SUCCEEDED(m_Device->UpdateTexture(staging, m_Texture));
 
-            for (size_t y = 0; y < bitmap.Size().y; ++y) {
-                for (size_t x = 0; x < bitmap.Size().x; ++x) {
-                    const auto &color = pixels[y * static_cast<size_t>(bitmap.Size().x) + x];
-                    D3DCOLOR *pixel = reinterpret_cast<D3DCOLOR *>(lockedRect.pBits) + y * lockedRect.Pitch / 4 + x;
-                    *pixel = D3DCOLOR_ARGB(color.a, color.r, color.g, color.b);
-                }
+            if (staging) {
+                staging->Release();
             }
+        }
 
-            m_Texture->UnlockRect(0);
-        } else {
+        if (!uploaded) {
             g_LoggerD3D9Texture.Log(runtime::LOG_LEVEL_ERROR, "Failed to upload texture data!");
+            m_Texture->Release();
+            m_Texture = nullptr;
+            return false;
+        }
+
+        if (m_TextureBudget) {
+            m_TextureBudget->OnTextureResident(this);
+        }
+
+        return true;
+    }
+
+    bool D3D9Texture::MakeResident() {
+        if (IsResident()) {
+            return true;
+        }
+
+        if (m_SourcePixels.empty() || !Restore()) {
+            return false;
+        }
+
+        if (m_TextureBudget) {
+            m_TextureBudget->OnTextureRestored(this);
+        }
+
+        return true;
+    }
+
+    bool D3D9Texture::Evict() {
+        if (!CanEvict()) {
             return false;
         }
 
-        g_LoggerD3D9Texture.Log(runtime::LOG_LEVEL_INFO, "Texture created and uploaded successfully!");
+        m_Texture->Release();
+        m_Texture = nullptr;
+
+        m_TextureBudget->OnTextureReleased(this);
+
+        return true;
+    }
+
+    void D3D9Texture::OnDeviceLost() {
+        m_RestoreOnReset = IsResident();
+
+        if (m_TextureBudget && m_RestoreOnReset) {
+            m_TextureBudget->OnTextureReleased(this);
+        }
+
+        if (m_Surface) {
+            m_Surface->Release();
+            m_Surface = nullptr;
+        }
+
+        if (m_Texture) {
+            m_Texture->Release();
+            m_Texture = nullptr;
+        }
+    }
+
+    bool D3D9Texture::OnDeviceReset() {
+        if (!m_RestoreOnReset) {
+            return true;
+        }
+
+        m_RestoreOnReset = false;
+
+        // render target contents are produced every frame, only the surfaces need to come back
+        if (m_IsRenderTarget) {
+            return CreateRenderTarget(m_Width, m_Height, m_Format);
+        }
+
+        return Restore();
+    }
+
+    bool D3D9Texture::CreateRenderTarget(uint32_t width, uint32_t height, D3D9TextureFormat format) {
+        g_LoggerD3D9Texture.Log(runtime::LOG_LEVEL_DEBUG, "Creating render target %ux%u...", width, height);
+
+        if (!m_Device || width == 0 || height == 0) {
+            return false;
+        }
+
+        if (m_Texture || m_Surface) {
+            Destroy();
+        }
+
+        // render targets are never evicted themselves, but may push evictable textures out
+        if (m_TextureBudget) {
+            m_TextureBudget->Reserve(static_cast<size_t>(width) * height * D3D9_GetTextureFormatPixelSize(format), this);
+        }
+
+        HRESULT hr;
+
+        if (format == D3D9TextureFormat::TEXTURE_FORMAT_D24S8) {
+            hr = m_Device->CreateDepthStencilSurface(width, height, D3D9_ConvertTextureFormat(format), D3DMULTISAMPLE_NONE, 0, TRUE, &m_Surface, nullptr);
+        } else {
+            hr = m_Device->CreateTexture(width, height, 1, D3DUSAGE_RENDERTARGET, D3D9_ConvertTextureFormat(format), D3DPOOL_DEFAULT, &m_Texture, nullptr);
+
+            if (SUCCEEDED(hr)) {
+                hr = m_Texture->GetSurfaceLevel(0, &m_Surface);
+            }
+        }
+
+        if (FAILED(hr)) {
+            g_LoggerD3D9Texture.Log(runtime::LOG_LEVEL_ERROR, "Failed to create render target. Error: 0x%08x", hr);
+            Destroy();
+            return false;
+        }
+
+        m_Width = width;
+        m_Height = height;
+        m_Format = format;
+        m_IsRenderTarget = true;
+        m_IsManaged = false;
+        m_ByteSize = static_cast<size_t>(width) * height * D3D9_GetTextureFormatPixelSize(format);
+
+        // render targets count towards the budget but are never evicted
+        if (m_TextureBudget) {
+            m_TextureBudget->Register(this);
+            m_TextureBudget->OnTextureResident(this);
+        }
+
+        if (m_ResourceRegistry) {
+            m_ResourceRegistry->Register(this);
+        }
 
         return true;
     }
@@ -48,28 +313,137 @@ namespace engine::backend::dx9 {
     void D3D9Texture::Destroy() {
         g_LoggerD3D9Texture.Log(runtime::LOG_LEVEL_DEBUG, "Texture is being destroyed.");
 
+        if (m_TextureBudget) {
+            if (IsResident()) {
+                m_TextureBudget->OnTextureReleased(this);
+            }
+
+            m_TextureBudget->Unregister(this);
+        }
+
+        if (m_ResourceRegistry) {
+            m_ResourceRegistry->Unregister(this);
+        }
+
+        if (m_Surface) {
+            m_Surface->Release();
+            m_Surface = nullptr;
+        }
+
         if (m_Texture) {
             m_Texture->Release();
             m_Texture = nullptr;
         }
+
+        m_SourcePixels.clear();
+        m_SourcePixels.shrink_to_fit();
+        m_Width = 0;
+        m_Height = 0;
+        m_ByteSize = 0;
     }
 
     core::runtime::graphics::Bitmap D3D9Texture::Download() {
-        // not able to download
-        return {};
+        if (m_Format != D3D9TextureFormat::TEXTURE_FORMAT_RGBA8) {
+            g_LoggerD3D9Texture.Log(runtime::LOG_LEVEL_ERROR, "Only RGBA8 textures can be downloaded.");
+            return {};
+        }
+
+        auto size = GetSize();
+        auto width = static_cast<uint32_t>(size.x);
+        auto height = static_cast<uint32_t>(size.y);
+
+        std::vector<core::runtime::graphics::Color> pixels;
+        D3DLOCKED_RECT lockedRect;
+
+        // budgeted textures live in D3DPOOL_DEFAULT, which can't be locked; their CPU-side copy has the same pixels
+        if (!m_IsRenderTarget && !m_SourcePixels.empty()) {
+            lockedRect.Pitch = static_cast<INT>(width * sizeof(uint32_t));
+            lockedRect.pBits = m_SourcePixels.data();
+
+            D3D9_ReadPixels(lockedRect, width, height, pixels);
+            return core::runtime::graphics::Bitmap(size, std::move(pixels));
+        }
+
+        if (!m_Device || !MakeResident()) {
+            return {};
+        }
+
+        if (!m_IsRenderTarget) {
+            // managed textures are lockable directly
+            if (FAILED(m_Texture->LockRect(0, &lockedRect, nullptr, D3DLOCK_READONLY))) {
+                g_LoggerD3D9Texture.Log(runtime::LOG_LEVEL_ERROR, "Failed to lock texture for download!");
+                return {};
+            }
+
+            D3D9_ReadPixels(lockedRect, width, height, pixels);
+            m_Texture->UnlockRect(0);
+
+            return core::runtime::graphics::Bitmap(size, std::move(pixels));
+        }
+
+        // render targets live in video memory only, so they are copied into a system memory surface first
+        IDirect3DSurface9 *readback = m_RenderTargetPool ? m_RenderTargetPool->AcquireReadbackSurface(width, height, m_Format) : nullptr;
+        bool isPooled = readback != nullptr;
+
+        if (!readback) {
+            HRESULT hr = m_Device->CreateOffscreenPlainSurface(width, height, D3D9_ConvertTextureFormat(m_Format), D3DPOOL_SYSTEMMEM, &readback, nullptr);
+            if (FAILED(hr)) {
+                g_LoggerD3D9Texture.Log(runtime::LOG_LEVEL_ERROR, "Failed to create readback surface! Error: 0x%08x", hr);
+                return {};
+            }
+        }
+
+        HRESULT hr = m_Device->GetRenderTargetData(m_Surface, readback);
+        if (SUCCEEDED(hr)) {
+            hr = readback->LockRect(&lockedRect, nullptr, D3DLOCK_READONLY);
+        }
+
+        if (SUCCEEDED(hr)) {
+            D3D9_ReadPixels(lockedRect, width, height, pixels);
+            readback->UnlockRect();
+        } else {
+            g_LoggerD3D9Texture.Log(runtime::LOG_LEVEL_ERROR, "Failed to read back render target! Error: 0x%08x", hr);
+        }
+
+        if (isPooled) {
+            m_RenderTargetPool->ReleaseReadbackSurface(readback);
+        } else {
+            readback->Release();
+        }
+
+        if (pixels.empty()) {
+            return {};
+        }
+
+        return core::runtime::graphics::Bitmap(size, std::move(pixels));
     }
 
     core::math::Vector2 D3D9Texture::GetSize() {
-        if (!m_Texture) {
-            return {0, 0};
+        if (m_Width > 0 && m_Height > 0) {
+            return {static_cast<float>(m_Width), static_cast<float>(m_Height)};
         }
 
         D3DSURFACE_DESC desc;
-        m_Texture->GetLevelDesc(0, &desc);
+
+        if (m_Texture) {
+            m_Texture->GetLevelDesc(0, &desc);
+        } else if (m_Surface) {
+            m_Surface->GetDesc(&desc);
+        } else {
+            return {0, 0};
+        }
+
         return {static_cast<float>(desc.Width), static_cast<float>(desc.Height)};
     }
 
     void D3D9Texture::Bind(int samplerSlot) {
+        if (m_TextureBudget) {
+            m_LastUsedFrame = m_TextureBudget->GetFrameIndex();
+        }
+
+        // evicted textures come back on first use, also when the budget that evicted them is gone by now
+        MakeResident();
+
         if (m_Device && m_Texture) {
             m_Device->SetTexture(samplerSlot, m_Texture);
 
@@ -0,0 +1,127 @@
+#include <Engine/Backend/D3D9/D3D9_TextureBudget.hpp>
+#include <Engine/Backend/D3D9/D3D9_Texture.hpp>
+#include <Engine/Runtime/Logger.hpp>
+
+#include <algorithm>
+
+#include <d3d9.h>
+
+namespace engine::backend::dx9 {
+    static runtime::Logger g_LoggerD3D9TextureBudget("D3D9TextureBudget");
+
+    D3D9TextureBudget::~D3D9TextureBudget() {
+        for (auto texture: m_Textures) {
+            texture->OnBudgetDestroyed();
+        }
+
+        m_Textures.clear();
+    }
+
+    void D3D9TextureBudget::Register(D3D9Texture *texture) {
+        if (std::find(m_Textures.begin(), m_Textures.end(), texture) == m_Textures.end()) {
+            m_Textures.push_back(texture);
+        }
+    }
+
+    void D3D9TextureBudget::Unregister(D3D9Texture *texture) {
+        auto it = std::find(m_Textures.begin(), m_Textures.end(), texture);
+        if (it != m_Textures.end()) {
+            *it = m_Textures.back();
+            m_Textures.pop_back();
+        }
+    }
+
+    void D3D9TextureBudget::OnTextureResident(D3D9Texture *texture) {
+        m_ResidentBytes += texture->GetByteSize();
+    }
+
+    void D3D9TextureBudget::OnTextureReleased(D3D9Texture *texture) {
+        m_ResidentBytes -= std::min(m_ResidentBytes, texture->GetByteSize());
+    }
+
+    void D3D9TextureBudget::BeginFrame() {
+        m_FrameIndex++;
+
+        if (m_BudgetBytes > 0 && m_ResidentBytes > m_BudgetBytes) {
+            Evict(m_ResidentBytes - m_BudgetBytes, nullptr);
+        }
+
+        if (m_LowMemoryThreshold > 0 && m_Device) {
+            size_t available = m_Device->GetAvailableTextureMem();
+
+            if (available < m_LowMemoryThreshold) {
+                g_LoggerD3D9TextureBudget.Log(runtime::LOG_LEVEL_WARNING, "Available texture memory is low (%u MB), evicting textures.", static_cast<unsigned int>(available / (1024 * 1024)));
+                Evict(m_LowMemoryThreshold - available, nullptr);
+            }
+        }
+    }
+
+    bool D3D9TextureBudget::Reserve(size_t bytes, const D3D9Texture *requester) {
+        if (m_BudgetBytes == 0 || m_ResidentBytes + bytes <= m_BudgetBytes) {
+            return true;
+        }
+
+        Evict(m_ResidentBytes + bytes - m_BudgetBytes, requester);
+
+        // going over budget is preferred to failing the allocation outright
+        return m_ResidentBytes + bytes <= m_BudgetBytes;
+    }
+
+    size_t D3D9TextureBudget::Evict(size_t bytes, const D3D9Texture *requester) {
+        std::vector<D3D9Texture *> candidates;
+
+        for (auto texture: m_Textures) {
+            // textures bound this frame may still be referenced by queued draws
+            if (texture != requester && texture->CanEvict() && texture->GetLastUsedFrame() < m_FrameIndex) {
+                candidates.push_back(texture);
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const D3D9Texture *a, const D3D9Texture *b) {
+            return a->GetLastUsedFrame() < b->GetLastUsedFrame();
+        });
+
+        size_t freed = 0;
+
+        for (auto texture: candidates) {
+            if (freed >= bytes) {
+                break;
+            }
+
+            size_t size = texture->GetByteSize();
+            if (texture->Evict()) {
+                freed += size;
+                m_EvictionCount++;
+            }
+        }
+
+        if (freed > 0) {
+            g_LoggerD3D9TextureBudget.Log(runtime::LOG_LEVEL_DEBUG, "Evicted %u KB of textures.", static_cast<unsigned int>(freed / 1024));
+        }
+
+        return freed;
+    }
+
+    bool D3D9TextureBudget::IsResident(const D3D9Texture *texture) const {
+        return texture->IsResident();
+    }
+
+    D3D9TextureBudgetStats D3D9TextureBudget::GetStats() const {
+        D3D9TextureBudgetStats stats{};
+        stats.m_BudgetBytes = m_BudgetBytes;
+        stats.m_ResidentBytes = m_ResidentBytes;
+        stats.m_EvictionCount = m_EvictionCount;
+        stats.m_RestoreCount = m_RestoreCount;
+
+        for (auto texture: m_Textures) {
+            if (texture->IsResident()) {
+                stats.m_ResidentCount++;
+            } else {
+                stats.m_EvictedCount++;
+                stats.m_EvictedBytes += texture->GetByteSize();
+            }
+        }
+
+        return stats;
+    }
+}
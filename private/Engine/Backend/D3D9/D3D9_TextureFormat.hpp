@@ -0,0 +1,11 @@
+#pragma once
+
+#include <Engine/Backend/D3D9/D3D9_Texture.hpp>
+
+#include <d3d9.h>
+
+namespace engine::backend::dx9 {
+    D3DFORMAT D3D9_ConvertTextureFormat(D3D9TextureFormat format);
+
+    uint32_t D3D9_GetTextureFormatPixelSize(D3D9TextureFormat format);
+}
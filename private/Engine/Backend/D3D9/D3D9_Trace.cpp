@@ -0,0 +1,273 @@
+#include <Engine/Backend/D3D9/D3D9_Trace.hpp>
+#include <Engine/Runtime/Logger.hpp>
+
+namespace engine::backend::dx9 {
+    static runtime::Logger g_LoggerD3D9Trace("D3D9Trace");
+
+    const char *D3D9_GetTraceOpName(D3D9TraceOp op) {
+        switch (op) {
+            case TRACE_OP_BLOB: return "Blob";
+            case TRACE_OP_RELEASE: return "Release";
+            case TRACE_OP_BACKEND_INITIALIZE: return "Backend::Initialize";
+            case TRACE_OP_BACKEND_SHUTDOWN: return "Backend::Shutdown";
+            case TRACE_OP_BACKEND_SET_VIEWPORT: return "Backend::SetViewport";
+            case TRACE_OP_BACKEND_SET_SCISSOR: return "Backend::SetScissor";
+            case TRACE_OP_BACKEND_ENABLE_FEATURES: return "Backend::EnableFeatures";
+            case TRACE_OP_BACKEND_DISABLE_FEATURES: return "Backend::DisableFeatures";
+            case TRACE_OP_BACKEND_CLEAR: return "Backend::Clear";
+            case TRACE_OP_BACKEND_CREATE_VERTEX_BUFFER: return "Backend::CreateVertexBuffer";
+            case TRACE_OP_BACKEND_CREATE_SHADER: return "Backend::CreateShader";
+            case TRACE_OP_BACKEND_CREATE_SHADER_PROGRAM: return "Backend::CreateShaderProgram";
+            case TRACE_OP_BACKEND_CREATE_TEXTURE: return "Backend::CreateTexture";
+            case TRACE_OP_VERTEX_BUFFER_CREATE: return "VertexBuffer::Create";
+            case TRACE_OP_VERTEX_BUFFER_DESTROY: return "VertexBuffer::Destroy";
+            case TRACE_OP_VERTEX_BUFFER_BIND: return "VertexBuffer::Bind";
+            case TRACE_OP_VERTEX_BUFFER_UNBIND: return "VertexBuffer::Unbind";
+            case TRACE_OP_VERTEX_BUFFER_DRAW: return "VertexBuffer::Draw";
+            case TRACE_OP_VERTEX_BUFFER_UPLOAD: return "VertexBuffer::Upload";
+            case TRACE_OP_SHADER_COMPILE: return "Shader::Compile";
+            case TRACE_OP_SHADER_DESTROY: return "Shader::Destroy";
+            case TRACE_OP_SHADER_SET_SOURCE: return "Shader::SetSource";
+            case TRACE_OP_SHADER_USE_COMPILED: return "Shader::UseCompiledShader";
+            case TRACE_OP_PROGRAM_LINK: return "ShaderProgram::Link";
+            case TRACE_OP_PROGRAM_DESTROY: return "ShaderProgram::Destroy";
+            case TRACE_OP_PROGRAM_BIND: return "ShaderProgram::Bind";
+            case TRACE_OP_PROGRAM_UNBIND: return "ShaderProgram::Unbind";
+            case TRACE_OP_PROGRAM_ADD_SHADER: return "ShaderProgram::AddShader";
+            case TRACE_OP_PROGRAM_SET_UNIFORM_MAT4: return "ShaderProgram::SetUniformMat4";
+            case TRACE_OP_PROGRAM_SET_UNIFORM_I: return "ShaderProgram::SetUniformI";
+            case TRACE_OP_TEXTURE_CREATE: return "Texture::Create";
+            case TRACE_OP_TEXTURE_DESTROY: return "Texture::Destroy";
+            case TRACE_OP_TEXTURE_BIND: return "Texture::Bind";
+            case TRACE_OP_TEXTURE_UNBIND: return "Texture::Unbind";
+            case TRACE_OP_FRAME: return "Frame";
+            case TRACE_OP_BACKEND_BEGIN_FRAME: return "Backend::BeginFrame";
+            case TRACE_OP_BACKEND_END_FRAME: return "Backend::EndFrame";
+            case TRACE_OP_BACKEND_CLEAR_DESC: return "Backend::Clear(D3D9ClearDesc)";
+            default: return "Unknown";
+        }
+    }
+
+    uint64_t D3D9_HashTraceBlob(std::span<const unsigned char> data) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+
+        for (auto byte: data) {
+            hash ^= byte;
+            hash *= 0x100000001b3ull;
+        }
+
+        return hash;
+    }
+
+    void D3D9_WriteTraceClearDesc(D3D9TracePayload &payload, const D3D9ClearDesc &desc) {
+        payload.Write(desc.m_Flags);
+        payload.Write(desc.m_Color);
+        payload.Write(desc.m_Depth);
+        payload.Write(desc.m_Stencil);
+        payload.Write(static_cast<uint32_t>(desc.m_Rects.size()));
+
+        for (auto &rect: desc.m_Rects) {
+            payload.Write(rect);
+        }
+    }
+
+    bool D3D9_ReadTraceClearDesc(D3D9TracePayloadReader &payload, D3D9ClearDesc &desc) {
+        desc.m_Flags = payload.Read<uint32_t>();
+        desc.m_Color = payload.Read<core::runtime::graphics::Color>();
+        desc.m_Depth = payload.Read<float>();
+        desc.m_Stencil = payload.Read<uint32_t>();
+
+        auto rectCount = payload.Read<uint32_t>();
+
+        // checked against the payload first, a corrupt count must not allocate gigabytes
+        if (payload.m_Overflow || rectCount > (payload.m_Data.size() - payload.m_Offset) / sizeof(D3D9ClearRect)) {
+            return false;
+        }
+
+        desc.m_Rects.resize(rectCount);
+        for (auto &rect: desc.m_Rects) {
+            rect = payload.Read<D3D9ClearRect>();
+        }
+
+        return !payload.m_Overflow;
+    }
+
+    bool D3D9TraceWriter::Open(const std::string &path) {
+        Close();
+
+        m_File.open(path, std::ios::binary | std::ios::trunc);
+        if (!m_File) {
+            g_LoggerD3D9Trace.Log(runtime::LOG_LEVEL_ERROR, "Failed to open '%s' for writing.", path.c_str());
+            return false;
+        }
+
+        D3D9TraceHeader header{D3D9_TRACE_MAGIC, D3D9_TRACE_VERSION};
+        m_File.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        m_NextObjectId = 1;
+        m_WrittenBlobs.clear();
+        m_Stats = {};
+        m_Stats.m_BytesWritten = sizeof(header);
+
+        return true;
+    }
+
+    void D3D9TraceWriter::Close() {
+        if (!m_File.is_open()) {
+            return;
+        }
+
+        m_File.close();
+
+        g_LoggerD3D9Trace.Log(
+                runtime::LOG_LEVEL_INFO,
+                "Trace closed: %llu calls, %llu blobs, %llu duplicate blobs (%llu bytes) skipped, %llu bytes written.",
+                static_cast<unsigned long long>(m_Stats.m_Calls),
+                static_cast<unsigned long long>(m_Stats.m_Blobs),
+                static_cast<unsigned long long>(m_Stats.m_DeduplicatedBlobs),
+                static_cast<unsigned long long>(m_Stats.m_DeduplicatedBytes),
+                static_cast<unsigned long long>(m_Stats.m_BytesWritten)
+        );
+    }
+
+    void D3D9TraceWriter::WriteCall(D3D9TraceOp op, uint32_t object, const D3D9TracePayload &payload) {
+        if (!m_File.is_open()) {
+            return;
+        }
+
+        WriteRecord(op, object, payload.m_Data);
+        m_Stats.m_Calls++;
+    }
+
+    D3D9TraceBlobKey D3D9TraceWriter::WriteBlob(std::span<const unsigned char> data) {
+        D3D9TraceBlobKey key{D3D9_HashTraceBlob(data), data.size()};
+
+        if (!m_File.is_open()) {
+            return key;
+        }
+
+        if (!m_WrittenBlobs.insert(key).second) {
+            m_Stats.m_DeduplicatedBlobs++;
+            m_Stats.m_DeduplicatedBytes += data.size();
+            return key;
+        }
+
+        D3D9TracePayload payload;
+        payload.WriteBlobKey(key);
+        payload.m_Data.insert(payload.m_Data.end(), data.begin(), data.end());
+
+        WriteRecord(TRACE_OP_BLOB, 0, payload.m_Data);
+        m_Stats.m_Blobs++;
+
+        return key;
+    }
+
+    void D3D9TraceWriter::WriteRecord(D3D9TraceOp op, uint32_t object, std::span<const unsigned char> payload) {
+        D3D9TraceRecord record{};
+        record.m_Op = op;
+        record.m_Object = object;
+        record.m_PayloadSize = static_cast<uint32_t>(payload.size());
+
+        m_File.write(reinterpret_cast<const char *>(&record), sizeof(record));
+        m_File.write(reinterpret_cast<const char *>(payload.data()), static_cast<std::streamsize>(payload.size()));
+
+        m_Stats.m_BytesWritten += sizeof(record) + payload.size();
+    }
+
+    bool D3D9TraceReader::Open(const std::string &path) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            g_LoggerD3D9Trace.Log(runtime::LOG_LEVEL_ERROR, "Failed to open trace '%s'.", path.c_str());
+            return false;
+        }
+
+        std::vector<unsigned char> data(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size()));
+
+        if (!file) {
+            g_LoggerD3D9Trace.Log(runtime::LOG_LEVEL_ERROR, "Failed to read trace '%s'.", path.c_str());
+            return false;
+        }
+
+        return OpenFromMemory(std::move(data));
+    }
+
+    bool D3D9TraceReader::OpenFromMemory(std::vector<unsigned char> data) {
+        m_Data = std::move(data);
+        m_Calls.clear();
+        m_Blobs.clear();
+
+        if (!Parse()) {
+            m_Data.clear();
+            m_Calls.clear();
+            m_Blobs.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    std::span<const unsigned char> D3D9TraceReader::FindBlob(const D3D9TraceBlobKey &key) const {
+        auto it = m_Blobs.find(key);
+        if (it == m_Blobs.end()) {
+            return {};
+        }
+
+        return it->second;
+    }
+
+    bool D3D9TraceReader::Parse() {
+        if (m_Data.size() < sizeof(D3D9TraceHeader)) {
+            g_LoggerD3D9Trace.Log(runtime::LOG_LEVEL_ERROR, "Trace is too small.");
+            return false;
+        }
+
+        D3D9TraceHeader header;
+        memcpy(&header, m_Data.data(), sizeof(header));
+
+        if (header.m_Magic != D3D9_TRACE_MAGIC || header.m_Version < D3D9_TRACE_MIN_VERSION || header.m_Version > D3D9_TRACE_VERSION) {
+            g_LoggerD3D9Trace.Log(runtime::LOG_LEVEL_ERROR, "Not a trace file, or an unsupported trace version.");
+            return false;
+        }
+
+        size_t offset = sizeof(header);
+
+        while (offset < m_Data.size()) {
+            D3D9TraceRecord record;
+
+            if (offset + sizeof(record) > m_Data.size()) {
+                g_LoggerD3D9Trace.Log(runtime::LOG_LEVEL_ERROR, "Truncated trace record at offset %u.", static_cast<unsigned int>(offset));
+                return false;
+            }
+
+            memcpy(&record, m_Data.data() + offset, sizeof(record));
+            offset += sizeof(record);
+
+            if (offset + record.m_PayloadSize > m_Data.size() || record.m_Op >= TRACE_OP_COUNT) {
+                g_LoggerD3D9Trace.Log(runtime::LOG_LEVEL_ERROR, "Invalid trace record at offset %u.", static_cast<unsigned int>(offset - sizeof(record)));
+                return false;
+            }
+
+            std::span<const unsigned char> payload(m_Data.data() + offset, record.m_PayloadSize);
+            offset += record.m_PayloadSize;
+
+            if (record.m_Op == TRACE_OP_BLOB) {
+                D3D9TracePayloadReader reader(payload);
+                auto key = reader.ReadBlobKey();
+
+                if (reader.m_Overflow || key.m_Size != payload.size() - reader.m_Offset) {
+                    g_LoggerD3D9Trace.Log(runtime::LOG_LEVEL_ERROR, "Invalid trace blob.");
+                    return false;
+                }
+
+                m_Blobs[key] = payload.subspan(reader.m_Offset);
+                continue;
+            }
+
+            m_Calls.push_back({static_cast<D3D9TraceOp>(record.m_Op), record.m_Object, payload});
+        }
+
+        return true;
+    }
+}
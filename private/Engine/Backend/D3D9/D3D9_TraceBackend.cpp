@@ -0,0 +1,386 @@
+#include <Engine/Backend/D3D9/D3D9_TraceBackend.hpp>
+#include <Engine/Runtime/Logger.hpp>
+
+namespace engine::backend::dx9 {
+    static runtime::Logger g_LoggerD3D9TraceBackend("D3D9TraceBackend");
+
+    template<typename T>
+    static std::span<const unsigned char> D3D9_AsBytes(const std::vector<T> &data) {
+        return {reinterpret_cast<const unsigned char *>(data.data()), data.size() * sizeof(T)};
+    }
+
+    // base of the recording resources; releases are recorded so replays free objects at the same point
+    struct D3D9TraceObject {
+        D3D9TraceObject(D3D9TraceWriter *writer) : m_Writer(writer), m_ObjectId(writer->AllocateObjectId()) {}
+
+        virtual ~D3D9TraceObject() {
+            m_Writer->WriteCall(TRACE_OP_RELEASE, m_ObjectId);
+        }
+
+        void Record(D3D9TraceOp op, const D3D9TracePayload &payload = {}) {
+            m_Writer->WriteCall(op, m_ObjectId, payload);
+        }
+
+        D3D9TraceWriter *m_Writer;
+        uint32_t m_ObjectId;
+    };
+
+    struct D3D9TraceVertexBuffer : public core::runtime::graphics::IVertexBuffer, public D3D9TraceObject {
+        D3D9TraceVertexBuffer(std::unique_ptr<core::runtime::graphics::IVertexBuffer> buffer, D3D9TraceWriter *writer) :
+                D3D9TraceObject(writer),
+                m_Buffer(std::move(buffer)) {}
+
+        bool Create() override {
+            Record(TRACE_OP_VERTEX_BUFFER_CREATE);
+            return m_Buffer->Create();
+        }
+
+        void Destroy() override {
+            Record(TRACE_OP_VERTEX_BUFFER_DESTROY);
+            m_Buffer->Destroy();
+        }
+
+        void Bind() override {
+            Record(TRACE_OP_VERTEX_BUFFER_BIND);
+            m_Buffer->Bind();
+        }
+
+        void Unbind() override {
+            Record(TRACE_OP_VERTEX_BUFFER_UNBIND);
+            m_Buffer->Unbind();
+        }
+
+        void Draw() override {
+            Record(TRACE_OP_VERTEX_BUFFER_DRAW);
+            m_Buffer->Draw();
+        }
+
+        void Upload(
+                const std::vector<core::runtime::graphics::Vertex> &data,
+                core::runtime::graphics::PrimitiveType type,
+                core::runtime::graphics::BufferUsageHint usage
+        ) override {
+            D3D9TracePayload payload;
+            payload.WriteBlobKey(m_Writer->WriteBlob(D3D9_AsBytes(data)));
+            payload.Write(static_cast<uint32_t>(type));
+            payload.Write(static_cast<uint32_t>(usage));
+
+            Record(TRACE_OP_VERTEX_BUFFER_UPLOAD, payload);
+            m_Buffer->Upload(data, type, usage);
+        }
+
+        size_t Size() override {
+            return m_Buffer->Size();
+        }
+
+        core::runtime::graphics::PrimitiveType GetPrimitiveType() override {
+            return m_Buffer->GetPrimitiveType();
+        }
+
+        std::vector<core::runtime::graphics::Vertex> Download() override {
+            return m_Buffer->Download();
+        }
+
+        std::unique_ptr<core::runtime::graphics::IVertexBuffer> m_Buffer;
+    };
+
+    struct D3D9TraceShader : public core::runtime::graphics::IShader, public D3D9TraceObject {
+        D3D9TraceShader(std::unique_ptr<core::runtime::graphics::IShader> shader, D3D9TraceWriter *writer) :
+                D3D9TraceObject(writer),
+                m_Shader(std::move(shader)) {}
+
+        bool Compile() override {
+            Record(TRACE_OP_SHADER_COMPILE);
+            return m_Shader->Compile();
+        }
+
+        void Destroy() override {
+            Record(TRACE_OP_SHADER_DESTROY);
+            m_Shader->Destroy();
+        }
+
+        void SetSource(std::string_view source, core::runtime::graphics::ShaderType type) override {
+            D3D9TracePayload payload;
+            payload.WriteBlobKey(m_Writer->WriteBlob({reinterpret_cast<const unsigned char *>(source.data()), source.size()}));
+            payload.Write(static_cast<uint32_t>(type));
+
+            Record(TRACE_OP_SHADER_SET_SOURCE, payload);
+            m_Shader->SetSource(source, type);
+        }
+
+        std::string GetSource() override {
+            return m_Shader->GetSource();
+        }
+
+        std::string GetCompileLog() override {
+            return m_Shader->GetCompileLog();
+        }
+
+        bool IsCompiled() override {
+            return m_Shader->IsCompiled();
+        }
+
+        bool UseCompiledShader(const std::span<unsigned char> &data, core::runtime::graphics::ShaderType type) override {
+            D3D9TracePayload payload;
+            payload.WriteBlobKey(m_Writer->WriteBlob(data));
+            payload.Write(static_cast<uint32_t>(type));
+
+            Record(TRACE_OP_SHADER_USE_COMPILED, payload);
+            return m_Shader->UseCompiledShader(data, type);
+        }
+
+        std::span<unsigned char> GetCompiledShader() override {
+            return m_Shader->GetCompiledShader();
+        }
+
+        core::runtime::graphics::ShaderCapsFlags GetImplCapabilities() const override {
+            return m_Shader->GetImplCapabilities();
+        }
+
+        std::unique_ptr<core::runtime::graphics::IShader> m_Shader;
+    };
+
+    struct D3D9TraceShaderProgram : public core::runtime::graphics::IShaderProgram, public D3D9TraceObject {
+        D3D9TraceShaderProgram(std::unique_ptr<core::runtime::graphics::IShaderProgram> program, D3D9TraceWriter *writer) :
+                D3D9TraceObject(writer),
+                m_Program(std::move(program)) {}
+
+        bool Link() override {
+            Record(TRACE_OP_PROGRAM_LINK);
+            return m_Program->Link();
+        }
+
+        void Destroy() override {
+            Record(TRACE_OP_PROGRAM_DESTROY);
+            m_Program->Destroy();
+        }
+
+        void Bind() override {
+            Record(TRACE_OP_PROGRAM_BIND);
+            m_Program->Bind();
+        }
+
+        void Unbind() override {
+            Record(TRACE_OP_PROGRAM_UNBIND);
+            m_Program->Unbind();
+        }
+
+        void AddShader(std::unique_ptr<core::runtime::graphics::IShader> shader) override {
+            auto traceShader = dynamic_cast<D3D9TraceShader *>(shader.get());
+
+            if (!traceShader) {
+                // e.g. shaders created from a shader pack; the trace can't reproduce them
+                g_LoggerD3D9TraceBackend.Log(runtime::LOG_LEVEL_WARNING, "Shader added to a traced program wasn't created through the trace.");
+                m_Program->AddShader(std::move(shader));
+                return;
+            }
+
+            D3D9TracePayload payload;
+            payload.Write(traceShader->m_ObjectId);
+            Record(TRACE_OP_PROGRAM_ADD_SHADER, payload);
+
+            // the program takes the real shader; the wrapper is released here, like in the replay
+            m_Program->AddShader(std::move(traceShader->m_Shader));
+        }
+
+        void SetUniformMat4(std::string_view name, const glm::mat4 &mat) override {
+            D3D9TracePayload payload;
+            payload.WriteString(name);
+            payload.Write(mat);
+
+            Record(TRACE_OP_PROGRAM_SET_UNIFORM_MAT4, payload);
+            m_Program->SetUniformMat4(name, mat);
+        }
+
+        void SetUniformI(std::string_view name, int val) override {
+            D3D9TracePayload payload;
+            payload.WriteString(name);
+            payload.Write(static_cast<int32_t>(val));
+
+            Record(TRACE_OP_PROGRAM_SET_UNIFORM_I, payload);
+            m_Program->SetUniformI(name, val);
+        }
+
+        std::string GetLinkLog() override {
+            return m_Program->GetLinkLog();
+        }
+
+        bool IsLinked() override {
+            return m_Program->IsLinked();
+        }
+
+        std::unique_ptr<core::runtime::graphics::IShaderProgram> m_Program;
+    };
+
+    struct D3D9TraceTexture : public core::runtime::graphics::ITexture, public D3D9TraceObject {
+        D3D9TraceTexture(std::unique_ptr<core::runtime::graphics::ITexture> texture, D3D9TraceWriter *writer) :
+                D3D9TraceObject(writer),
+                m_Texture(std::move(texture)) {}
+
+        bool Create(const core::runtime::graphics::Bitmap &bitmap) override {
+            D3D9TracePayload payload;
+            payload.Write(bitmap.Size());
+            payload.WriteBlobKey(m_Writer->WriteBlob(D3D9_AsBytes(bitmap.GetPixels())));
+
+            Record(TRACE_OP_TEXTURE_CREATE, payload);
+            return m_Texture->Create(bitmap);
+        }
+
+        void Destroy() override {
+            Record(TRACE_OP_TEXTURE_DESTROY);
+            m_Texture->Destroy();
+        }
+
+        core::runtime::graphics::Bitmap Download() override {
+            return m_Texture->Download();
+        }
+
+        core::math::Vector2 GetSize() override {
+            return m_Texture->GetSize();
+        }
+
+        void Bind(int samplerSlot) override {
+            D3D9TracePayload payload;
+            payload.Write(static_cast<int32_t>(samplerSlot));
+
+            Record(TRACE_OP_TEXTURE_BIND, payload);
+            m_Texture->Bind(samplerSlot);
+        }
+
+        void Unbind() override {
+            Record(TRACE_OP_TEXTURE_UNBIND);
+            m_Texture->Unbind();
+        }
+
+        std::unique_ptr<core::runtime::graphics::ITexture> m_Texture;
+    };
+
+    bool D3D9TraceBackend::Initialize() {
+        m_Writer->WriteCall(TRACE_OP_BACKEND_INITIALIZE, 0);
+        return m_Backend->Initialize();
+    }
+
+    void D3D9TraceBackend::Shutdown() {
+        m_Writer->WriteCall(TRACE_OP_BACKEND_SHUTDOWN, 0);
+        m_Backend->Shutdown();
+    }
+
+    std::string D3D9TraceBackend::GetName() const {
+        return m_Backend->GetName();
+    }
+
+    std::string D3D9TraceBackend::GetIdentifier() const {
+        return m_Backend->GetIdentifier();
+    }
+
+    void D3D9TraceBackend::SetViewport(core::math::Vector2 pos, core::math::Vector2 size) {
+        D3D9TracePayload payload;
+        payload.Write(pos);
+        payload.Write(size);
+
+        m_Writer->WriteCall(TRACE_OP_BACKEND_SET_VIEWPORT, 0, payload);
+        m_Backend->SetViewport(pos, size);
+    }
+
+    void D3D9TraceBackend::SetScissor(core::math::Vector2 start, core::math::Vector2 size) {
+        D3D9TracePayload payload;
+        payload.Write(start);
+        payload.Write(size);
+
+        m_Writer->WriteCall(TRACE_OP_BACKEND_SET_SCISSOR, 0, payload);
+        m_Backend->SetScissor(start, size);
+    }
+
+    void D3D9TraceBackend::EnableFeatures(core::runtime::graphics::BackendFeature featuresMask) {
+        D3D9TracePayload payload;
+        payload.Write(static_cast<uint32_t>(featuresMask));
+
+        m_Writer->WriteCall(TRACE_OP_BACKEND_ENABLE_FEATURES, 0, payload);
+        m_Backend->EnableFeatures(featuresMask);
+    }
+
+    void D3D9TraceBackend::DisableFeatures(core::runtime::graphics::BackendFeature featuresMask) {
+        D3D9TracePayload payload;
+        payload.Write(static_cast<uint32_t>(featuresMask));
+
+        m_Writer->WriteCall(TRACE_OP_BACKEND_DISABLE_FEATURES, 0, payload);
+        m_Backend->DisableFeatures(featuresMask);
+    }
+
+    core::runtime::graphics::BackendFeature D3D9TraceBackend::GetActiveFeatures() {
+        return m_Backend->GetActiveFeatures();
+    }
+
+    void D3D9TraceBackend::Clear(core::runtime::graphics::Color color) {
+        D3D9TracePayload payload;
+        payload.Write(color);
+
+        m_Writer->WriteCall(TRACE_OP_BACKEND_CLEAR, 0, payload);
+        m_Backend->Clear(color);
+    }
+
+    std::unique_ptr<core::runtime::graphics::IVertexBuffer> D3D9TraceBackend::CreateVertexBuffer() {
+        auto buffer = std::make_unique<D3D9TraceVertexBuffer>(m_Backend->CreateVertexBuffer(), m_Writer);
+
+        D3D9TracePayload payload;
+        payload.Write(buffer->m_ObjectId);
+        m_Writer->WriteCall(TRACE_OP_BACKEND_CREATE_VERTEX_BUFFER, 0, payload);
+
+        return buffer;
+    }
+
+    std::unique_ptr<core::runtime::graphics::IShader> D3D9TraceBackend::CreateShader() {
+        auto shader = std::make_unique<D3D9TraceShader>(m_Backend->CreateShader(), m_Writer);
+
+        D3D9TracePayload payload;
+        payload.Write(shader->m_ObjectId);
+        m_Writer->WriteCall(TRACE_OP_BACKEND_CREATE_SHADER, 0, payload);
+
+        return shader;
+    }
+
+    std::unique_ptr<core::runtime::graphics::IShaderProgram> D3D9TraceBackend::CreateShaderProgram() {
+        auto program = std::make_unique<D3D9TraceShaderProgram>(m_Backend->CreateShaderProgram(), m_Writer);
+
+        D3D9TracePayload payload;
+        payload.Write(program->m_ObjectId);
+        m_Writer->WriteCall(TRACE_OP_BACKEND_CREATE_SHADER_PROGRAM, 0, payload);
+
+        return program;
+    }
+
+    std::unique_ptr<core::runtime::graphics::ITexture> D3D9TraceBackend::CreateTexture() {
+        auto texture = std::make_unique<D3D9TraceTexture>(m_Backend->CreateTexture(), m_Writer);
+
+        D3D9TracePayload payload;
+        payload.Write(texture->m_ObjectId);
+        m_Writer->WriteCall(TRACE_OP_BACKEND_CREATE_TEXTURE, 0, payload);
+
+        return texture;
+    }
+
+    void D3D9TraceBackend::MarkFrame() {
+        m_Writer->WriteCall(TRACE_OP_FRAME, 0);
+    }
+
+    bool D3D9FrameTraceBackend::Clear(const D3D9ClearDesc &desc) {
+        D3D9TracePayload payload;
+        D3D9_WriteTraceClearDesc(payload, desc);
+
+        m_Writer->WriteCall(TRACE_OP_BACKEND_CLEAR_DESC, 0, payload);
+        return m_FrameBackend->Clear(desc);
+    }
+
+    void D3D9FrameTraceBackend::BeginFrame(const D3D9ClearDesc &clear) {
+        D3D9TracePayload payload;
+        D3D9_WriteTraceClearDesc(payload, clear);
+
+        m_Writer->WriteCall(TRACE_OP_BACKEND_BEGIN_FRAME, 0, payload);
+        m_FrameBackend->BeginFrame(clear);
+    }
+
+    void D3D9FrameTraceBackend::EndFrame() {
+        m_Writer->WriteCall(TRACE_OP_BACKEND_END_FRAME, 0);
+        m_FrameBackend->EndFrame();
+    }
+}
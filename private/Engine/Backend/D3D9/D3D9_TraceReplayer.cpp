@@ -0,0 +1,366 @@
+#include <Engine/Backend/D3D9/D3D9_TraceReplayer.hpp>
+#include <Engine/Runtime/Logger.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+namespace engine::backend::dx9 {
+    static runtime::Logger g_LoggerD3D9TraceReplayer("D3D9TraceReplayer");
+
+    template<typename T>
+    static T *D3D9_FindTraceObject(std::unordered_map<uint32_t, std::unique_ptr<T>> &objects, uint32_t id) {
+        auto it = objects.find(id);
+        return it != objects.end() ? it->second.get() : nullptr;
+    }
+
+    // only the backend call itself is timed, decoding the payload is not part of the measurement
+    template<typename F>
+    static double D3D9_TimeTraceCall(F &&call) {
+        auto start = std::chrono::high_resolution_clock::now();
+        call();
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    bool D3D9TraceReplayer::Replay(const D3D9TraceReader &trace, D3D9TraceReplayStats &stats) {
+        stats = {};
+        stats.m_CallTimesMs.reserve(trace.Calls().size());
+
+        auto replayStart = std::chrono::high_resolution_clock::now();
+        auto frameStart = replayStart;
+
+        for (auto &call: trace.Calls()) {
+            double callMs = 0.0;
+
+            if (!Execute(trace, call, callMs)) {
+                stats.m_Errors++;
+            }
+
+            auto &timing = stats.m_Ops[call.m_Op];
+            timing.m_Count++;
+            timing.m_TotalMs += callMs;
+            timing.m_MaxMs = std::max(timing.m_MaxMs, callMs);
+
+            stats.m_CallTimesMs.push_back(static_cast<float>(callMs));
+
+            if (call.m_Op == TRACE_OP_FRAME) {
+                auto now = std::chrono::high_resolution_clock::now();
+                stats.m_FrameTimesMs.push_back(std::chrono::duration<double, std::milli>(now - frameStart).count());
+                frameStart = now;
+            }
+        }
+
+        Reset();
+
+        stats.m_TotalMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - replayStart).count();
+
+        if (stats.m_Errors > 0) {
+            g_LoggerD3D9TraceReplayer.Log(runtime::LOG_LEVEL_WARNING, "%llu trace calls could not be replayed.", static_cast<unsigned long long>(stats.m_Errors));
+        }
+
+        return stats.m_Errors == 0;
+    }
+
+    void D3D9TraceReplayer::Reset() {
+        // programs first, they may reference textures and shaders the same way the application did
+        m_Programs.clear();
+        m_Shaders.clear();
+        m_VertexBuffers.clear();
+        m_Textures.clear();
+    }
+
+    bool D3D9TraceReplayer::Execute(const D3D9TraceReader &trace, const D3D9TraceCall &call, double &callMs) {
+        D3D9TracePayloadReader payload(call.m_Payload);
+
+        switch (call.m_Op) {
+            case TRACE_OP_RELEASE:
+                m_VertexBuffers.erase(call.m_Object);
+                m_Shaders.erase(call.m_Object);
+                m_Programs.erase(call.m_Object);
+                m_Textures.erase(call.m_Object);
+                return true;
+
+            case TRACE_OP_BACKEND_INITIALIZE:
+            case TRACE_OP_BACKEND_SHUTDOWN:
+                return true;
+
+            case TRACE_OP_BACKEND_SET_VIEWPORT:
+            case TRACE_OP_BACKEND_SET_SCISSOR: {
+                auto position = payload.Read<core::math::Vector2>();
+                auto size = payload.Read<core::math::Vector2>();
+                if (payload.m_Overflow) return false;
+
+                if (call.m_Op == TRACE_OP_BACKEND_SET_VIEWPORT) {
+                    callMs = D3D9_TimeTraceCall([&] { m_Backend->SetViewport(position, size); });
+                } else {
+                    callMs = D3D9_TimeTraceCall([&] { m_Backend->SetScissor(position, size); });
+                }
+
+                return true;
+            }
+
+            case TRACE_OP_BACKEND_ENABLE_FEATURES:
+            case TRACE_OP_BACKEND_DISABLE_FEATURES: {
+                auto features = static_cast<core::runtime::graphics::BackendFeature>(payload.Read<uint32_t>());
+                if (payload.m_Overflow) return false;
+
+                if (call.m_Op == TRACE_OP_BACKEND_ENABLE_FEATURES) {
+                    callMs = D3D9_TimeTraceCall([&] { m_Backend->EnableFeatures(features); });
+                } else {
+                    callMs = D3D9_TimeTraceCall([&] { m_Backend->DisableFeatures(features); });
+                }
+
+                return true;
+            }
+
+            case TRACE_OP_BACKEND_CLEAR: {
+                auto color = payload.Read<core::runtime::graphics::Color>();
+                if (payload.m_Overflow) return false;
+
+                callMs = D3D9_TimeTraceCall([&] { m_Backend->Clear(color); });
+                return true;
+            }
+
+            case TRACE_OP_BACKEND_CREATE_VERTEX_BUFFER: {
+                auto id = payload.Read<uint32_t>();
+                if (payload.m_Overflow) return false;
+
+                callMs = D3D9_TimeTraceCall([&] { m_VertexBuffers[id] = m_Backend->CreateVertexBuffer(); });
+                return true;
+            }
+
+            case TRACE_OP_BACKEND_CREATE_SHADER: {
+                auto id = payload.Read<uint32_t>();
+                if (payload.m_Overflow) return false;
+
+                callMs = D3D9_TimeTraceCall([&] { m_Shaders[id] = m_Backend->CreateShader(); });
+                return true;
+            }
+
+            case TRACE_OP_BACKEND_CREATE_SHADER_PROGRAM: {
+                auto id = payload.Read<uint32_t>();
+                if (payload.m_Overflow) return false;
+
+                callMs = D3D9_TimeTraceCall([&] { m_Programs[id] = m_Backend->CreateShaderProgram(); });
+                return true;
+            }
+
+            case TRACE_OP_BACKEND_CREATE_TEXTURE: {
+                auto id = payload.Read<uint32_t>();
+                if (payload.m_Overflow) return false;
+
+                callMs = D3D9_TimeTraceCall([&] { m_Textures[id] = m_Backend->CreateTexture(); });
+                return true;
+            }
+
+            case TRACE_OP_VERTEX_BUFFER_CREATE:
+            case TRACE_OP_VERTEX_BUFFER_DESTROY:
+            case TRACE_OP_VERTEX_BUFFER_BIND:
+            case TRACE_OP_VERTEX_BUFFER_UNBIND:
+            case TRACE_OP_VERTEX_BUFFER_DRAW:
+            case TRACE_OP_VERTEX_BUFFER_UPLOAD: {
+                auto buffer = D3D9_FindTraceObject(m_VertexBuffers, call.m_Object);
+                if (!buffer) return false;
+
+                switch (call.m_Op) {
+                    case TRACE_OP_VERTEX_BUFFER_CREATE:
+                        callMs = D3D9_TimeTraceCall([&] { buffer->Create(); });
+                        return true;
+                    case TRACE_OP_VERTEX_BUFFER_DESTROY:
+                        callMs = D3D9_TimeTraceCall([&] { buffer->Destroy(); });
+                        return true;
+                    case TRACE_OP_VERTEX_BUFFER_BIND:
+                        callMs = D3D9_TimeTraceCall([&] { buffer->Bind(); });
+                        return true;
+                    case TRACE_OP_VERTEX_BUFFER_UNBIND:
+                        callMs = D3D9_TimeTraceCall([&] { buffer->Unbind(); });
+                        return true;
+                    case TRACE_OP_VERTEX_BUFFER_DRAW:
+                        callMs = D3D9_TimeTraceCall([&] { buffer->Draw(); });
+                        return true;
+                    default:
+                        break;
+                }
+
+                auto key = payload.ReadBlobKey();
+                auto type = static_cast<core::runtime::graphics::PrimitiveType>(payload.Read<uint32_t>());
+                auto usage = static_cast<core::runtime::graphics::BufferUsageHint>(payload.Read<uint32_t>());
+                auto blob = trace.FindBlob(key);
+
+                if (payload.m_Overflow || blob.size() != key.m_Size || blob.size() % sizeof(core::runtime::graphics::Vertex) != 0) {
+                    return false;
+                }
+
+                std::vector<core::runtime::graphics::Vertex> vertices(blob.size() / sizeof(core::runtime::graphics::Vertex));
+                if (!blob.empty()) {
+                    memcpy(vertices.data(), blob.data(), blob.size());
+                }
+
+                callMs = D3D9_TimeTraceCall([&] { buffer->Upload(vertices, type, usage); });
+                return true;
+            }
+
+            case TRACE_OP_SHADER_COMPILE:
+            case TRACE_OP_SHADER_DESTROY:
+            case TRACE_OP_SHADER_SET_SOURCE:
+            case TRACE_OP_SHADER_USE_COMPILED: {
+                auto shader = D3D9_FindTraceObject(m_Shaders, call.m_Object);
+                if (!shader) return false;
+
+                if (call.m_Op == TRACE_OP_SHADER_COMPILE) {
+                    callMs = D3D9_TimeTraceCall([&] { shader->Compile(); });
+                    return true;
+                }
+
+                if (call.m_Op == TRACE_OP_SHADER_DESTROY) {
+                    callMs = D3D9_TimeTraceCall([&] { shader->Destroy(); });
+                    return true;
+                }
+
+                auto key = payload.ReadBlobKey();
+                auto type = static_cast<core::runtime::graphics::ShaderType>(payload.Read<uint32_t>());
+                auto blob = trace.FindBlob(key);
+
+                if (payload.m_Overflow || blob.size() != key.m_Size) {
+                    return false;
+                }
+
+                if (call.m_Op == TRACE_OP_SHADER_SET_SOURCE) {
+                    std::string_view source(reinterpret_cast<const char *>(blob.data()), blob.size());
+                    callMs = D3D9_TimeTraceCall([&] { shader->SetSource(source, type); });
+                } else {
+                    // the shader only reads the bytecode, the trace is never written through this span
+                    std::span<unsigned char> bytecode(const_cast<unsigned char *>(blob.data()), blob.size());
+                    callMs = D3D9_TimeTraceCall([&] { shader->UseCompiledShader(bytecode, type); });
+                }
+
+                return true;
+            }
+
+            case TRACE_OP_PROGRAM_LINK:
+            case TRACE_OP_PROGRAM_DESTROY:
+            case TRACE_OP_PROGRAM_BIND:
+            case TRACE_OP_PROGRAM_UNBIND:
+            case TRACE_OP_PROGRAM_ADD_SHADER:
+            case TRACE_OP_PROGRAM_SET_UNIFORM_MAT4:
+            case TRACE_OP_PROGRAM_SET_UNIFORM_I: {
+                auto program = D3D9_FindTraceObject(m_Programs, call.m_Object);
+                if (!program) return false;
+
+                switch (call.m_Op) {
+                    case TRACE_OP_PROGRAM_LINK:
+                        callMs = D3D9_TimeTraceCall([&] { program->Link(); });
+                        return true;
+                    case TRACE_OP_PROGRAM_DESTROY:
+                        callMs = D3D9_TimeTraceCall([&] { program->Destroy(); });
+                        return true;
+                    case TRACE_OP_PROGRAM_BIND:
+                        callMs = D3D9_TimeTraceCall([&] { program->Bind(); });
+                        return true;
+                    case TRACE_OP_PROGRAM_UNBIND:
+                        callMs = D3D9_TimeTraceCall([&] { program->Unbind(); });
+                        return true;
+                    case TRACE_OP_PROGRAM_ADD_SHADER: {
+                        auto it = m_Shaders.find(payload.Read<uint32_t>());
+                        if (payload.m_Overflow || it == m_Shaders.end()) return false;
+
+                        // the program takes ownership, like it did when the trace was recorded
+                        auto shader = std::move(it->second);
+                        m_Shaders.erase(it);
+
+                        callMs = D3D9_TimeTraceCall([&] { program->AddShader(std::move(shader)); });
+                        return true;
+                    }
+                    case TRACE_OP_PROGRAM_SET_UNIFORM_MAT4: {
+                        auto name = payload.ReadString();
+                        auto matrix = payload.Read<glm::mat4>();
+                        if (payload.m_Overflow) return false;
+
+                        callMs = D3D9_TimeTraceCall([&] { program->SetUniformMat4(name, matrix); });
+                        return true;
+                    }
+                    default: {
+                        auto name = payload.ReadString();
+                        auto value = payload.Read<int32_t>();
+                        if (payload.m_Overflow) return false;
+
+                        callMs = D3D9_TimeTraceCall([&] { program->SetUniformI(name, value); });
+                        return true;
+                    }
+                }
+            }
+
+            case TRACE_OP_TEXTURE_CREATE:
+            case TRACE_OP_TEXTURE_DESTROY:
+            case TRACE_OP_TEXTURE_BIND:
+            case TRACE_OP_TEXTURE_UNBIND: {
+                auto texture = D3D9_FindTraceObject(m_Textures, call.m_Object);
+                if (!texture) return false;
+
+                switch (call.m_Op) {
+                    case TRACE_OP_TEXTURE_DESTROY:
+                        callMs = D3D9_TimeTraceCall([&] { texture->Destroy(); });
+                        return true;
+                    case TRACE_OP_TEXTURE_UNBIND:
+                        callMs = D3D9_TimeTraceCall([&] { texture->Unbind(); });
+                        return true;
+                    case TRACE_OP_TEXTURE_BIND: {
+                        auto slot = payload.Read<int32_t>();
+                        if (payload.m_Overflow) return false;
+
+                        callMs = D3D9_TimeTraceCall([&] { texture->Bind(slot); });
+                        return true;
+                    }
+                    default:
+                        break;
+                }
+
+                auto size = payload.Read<core::math::Vector2>();
+                auto key = payload.ReadBlobKey();
+                auto blob = trace.FindBlob(key);
+
+                if (payload.m_Overflow || blob.size() != key.m_Size || blob.size() % sizeof(core::runtime::graphics::Color) != 0) {
+                    return false;
+                }
+
+                std::vector<core::runtime::graphics::Color> pixels(blob.size() / sizeof(core::runtime::graphics::Color));
+                if (!blob.empty()) {
+                    memcpy(pixels.data(), blob.data(), blob.size());
+                }
+
+                core::runtime::graphics::Bitmap bitmap(size, std::move(pixels));
+                callMs = D3D9_TimeTraceCall([&] { texture->Create(bitmap); });
+                return true;
+            }
+
+            case TRACE_OP_FRAME:
+                if (m_FrameCallback) {
+                    callMs = D3D9_TimeTraceCall(m_FrameCallback);
+                }
+
+                return true;
+
+            case TRACE_OP_BACKEND_BEGIN_FRAME:
+            case TRACE_OP_BACKEND_CLEAR_DESC: {
+                D3D9ClearDesc desc;
+                if (!m_FrameBackend || !D3D9_ReadTraceClearDesc(payload, desc)) return false;
+
+                if (call.m_Op == TRACE_OP_BACKEND_BEGIN_FRAME) {
+                    callMs = D3D9_TimeTraceCall([&] { m_FrameBackend->BeginFrame(desc); });
+                } else {
+                    callMs = D3D9_TimeTraceCall([&] { m_FrameBackend->Clear(desc); });
+                }
+
+                return true;
+            }
+
+            case TRACE_OP_BACKEND_END_FRAME:
+                if (!m_FrameBackend) return false;
+
+                callMs = D3D9_TimeTraceCall([&] { m_FrameBackend->EndFrame(); });
+                return true;
+
+            default:
+                return false;
+        }
+    }
+}
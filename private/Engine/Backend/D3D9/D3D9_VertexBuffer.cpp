@@ -1,4 +1,5 @@
 #include <Engine/Backend/D3D9/D3D9_VertexBuffer.hpp>
+#include <Engine/Backend/D3D9/D3D9_VertexDeclaration.hpp>
 #include <Engine/Runtime/Logger.hpp>
 
 #include <d3d9.h>
@@ -17,6 +18,14 @@ namespace engine::backend::dx9 {
 
     static runtime::Logger g_LoggerD3D9VertexBuffer("D3D9VertexBuffer");
 
+    IDirect3DVertexDeclaration9 *D3D9_GetVertexDeclaration(IDirect3DDevice9 *device) {
+        if (D3D9_VertexDecl == nullptr) {
+            device->CreateVertexDeclaration(D3D9_VertexDeclList, &D3D9_VertexDecl);
+        }
+
+        return D3D9_VertexDecl;
+    }
+
     D3DPRIMITIVETYPE D3D9_ConvertPrimitiveType(core::runtime::graphics::PrimitiveType type) {
         switch (type) {
             default:
@@ -30,6 +39,10 @@ namespace engine::backend::dx9 {
     }
 
     size_t D3D9VertexBuffer::GetPrimitiveCount() const {
+        if (m_IsIndexed) {
+            return m_IndexCount / 3;
+        }
+
         switch (m_PrimType) {
             case core::runtime::graphics::PrimitiveType::PRIMITIVE_TYPE_TRIANGLES:
                 return m_VertexCount / 3;
@@ -42,6 +55,12 @@ namespace engine::backend::dx9 {
         }
     }
 
+    D3D9VertexBuffer::~D3D9VertexBuffer() {
+        if (m_ResourceRegistry) {
+            m_ResourceRegistry->Unregister(this);
+        }
+    }
+
     bool D3D9VertexBuffer::Create() {
         if (!m_Device) {
             g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_ERROR, "Device is NULL.");
@@ -55,12 +74,26 @@ namespace engine::backend::dx9 {
     void D3D9VertexBuffer::Destroy() {
         g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_DEBUG, "This vertex buffer is being destroyed.");
 
+        if (m_ResourceRegistry) {
+            m_ResourceRegistry->Unregister(this);
+        }
+
         if (m_VertexBuffer) {
             m_VertexBuffer->Release();
             m_VertexBuffer = nullptr;
         }
 
+        ReleaseIndexBuffer();
+
         m_BufferCapacity = 0;
+        m_ShadowData.clear();
+        m_ShadowData.shrink_to_fit();
+
+        m_Bounds = {};
+        m_IsIndexed = false;
+        m_IndexCount = 0;
+        m_Indices.clear();
+        m_Indices.shrink_to_fit();
     }
 
     void D3D9VertexBuffer::Bind() {
@@ -74,14 +107,24 @@ namespace engine::backend::dx9 {
     void D3D9VertexBuffer::Draw() {
         if (m_VertexBuffer && m_VertexCount > 0) {
             // set vertex format for DX
-            if (D3D9_VertexDecl == nullptr) {
-                m_Device->CreateVertexDeclaration(D3D9_VertexDeclList, &D3D9_VertexDecl);
+            m_Device->SetVertexDeclaration(D3D9_GetVertexDeclaration(m_Device));
+            m_Device->SetStreamSource(0, m_VertexBuffer, 0, sizeof(core::runtime::graphics::Vertex));
+
+            // upload the uniforms changed since the last draw
+            if (m_ShaderConstants) {
+                m_ShaderConstants->Flush(m_Device);
             }
 
-            m_Device->SetVertexDeclaration(D3D9_VertexDecl);
-            m_Device->SetStreamSource(0, m_VertexBuffer, 0, sizeof(core::runtime::graphics::Vertex));
+            HRESULT hr;
 
-            HRESULT hr = m_Device->DrawPrimitive(D3D9_ConvertPrimitiveType(m_PrimType), 0, GetPrimitiveCount());
+            if (m_IsIndexed) {
+                if (!m_IndexBuffer || m_IndexCount == 0) return;
+
+                m_Device->SetIndices(m_IndexBuffer);
+                hr = m_Device->DrawIndexedPrimitive(D3D9_ConvertPrimitiveType(m_PrimType), 0, 0, m_VertexCount, 0, GetPrimitiveCount());
+            } else {
+                hr = m_Device->DrawPrimitive(D3D9_ConvertPrimitiveType(m_PrimType), 0, GetPrimitiveCount());
+            }
 
             if(FAILED(hr)) {
                 g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_ERROR, "Failed to draw vertex buffer. Error: 0x%08x", hr);
@@ -94,59 +137,263 @@ namespace engine::backend::dx9 {
             core::runtime::graphics::PrimitiveType type,
             core::runtime::graphics::BufferUsageHint usage
     ) {
-        if (m_VertexBuffer && data.size() > m_BufferCapacity) {
+        // only static triangle lists are worth optimizing; anything else is re-uploaded too often or has no cache reuse
+        std::vector<core::runtime::graphics::Vertex> optimizedVertices;
+        std::vector<uint32_t> indices;
+
+        bool optimize = m_OptimizeMeshes &&
+                        usage == core::runtime::graphics::BufferUsageHint::BUFFER_USAGE_HINT_STATIC &&
+                        type == core::runtime::graphics::PrimitiveType::PRIMITIVE_TYPE_TRIANGLES &&
+                        D3D9_OptimizeMesh(data, optimizedVertices, indices, &m_MeshStats);
+
+        if (optimize && !optimizedVertices.empty()) {
+            // the device has to address every unique vertex; this also rules out 32-bit indices on hardware without them
+            D3DCAPS9 caps;
+            if (FAILED(m_Device->GetDeviceCaps(&caps)) || optimizedVertices.size() - 1 > caps.MaxVertexIndex) {
+                g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_WARNING, "The device can't index %u vertices, the mesh is drawn unindexed.", static_cast<unsigned int>(optimizedVertices.size()));
+                optimize = false;
+            }
+        }
+
+        if (optimize) {
+            if (UploadVertices(optimizedVertices, type, usage, true) && UploadIndices(std::move(indices))) {
+                g_LoggerD3D9VertexBuffer.Log(
+                        runtime::LOG_LEVEL_DEBUG,
+                        "Optimized mesh of %u triangles in %.2f ms: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f.",
+                        static_cast<unsigned int>(m_MeshStats.m_After.m_TriangleCount),
+                        m_MeshStats.m_OptimizeTimeMs,
+                        m_MeshStats.m_Before.m_ACMR, m_MeshStats.m_After.m_ACMR,
+                        m_MeshStats.m_Before.m_ATVR, m_MeshStats.m_After.m_ATVR
+                );
+                return;
+            }
+
+            // deduplicated vertices mean nothing without their indices, so the original triangle list is uploaded instead
+            g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_WARNING, "Failed to upload the optimized mesh, falling back to an unindexed draw.");
+        }
+
+        ReleaseIndexBuffer();
+        m_IndexCount = 0;
+        m_Indices.clear();
+        m_Indices.shrink_to_fit();
+
+        UploadVertices(data, type, usage, false);
+    }
+
+    bool D3D9VertexBuffer::UploadVertices(
+            const std::vector<core::runtime::graphics::Vertex> &vertices,
+            core::runtime::graphics::PrimitiveType type,
+            core::runtime::graphics::BufferUsageHint usage,
+            bool isIndexed
+    ) {
+        // Dynamic and stream contents change too often to scan every upload, their owner sets the bounds instead.
+        // Until it does they are unknown, which never culls the buffer; only a buffer without vertices is empty.
+        D3D9BoundingVolume bounds{};
+        if (usage == core::runtime::graphics::BufferUsageHint::BUFFER_USAGE_HINT_STATIC) {
+            bounds = D3D9_ComputeBounds(vertices);
+            m_HasOwnerBounds = false;
+        } else if (!vertices.empty()) {
+            bounds = m_HasOwnerBounds && m_Bounds.m_IsValid ? m_Bounds : D3D9_UnknownBounds();
+        }
+
+        if (m_VertexBuffer && vertices.size() > m_BufferCapacity) {
             g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_WARNING, "New vertex data exceeds buffer capacity. The buffer will be recreated!");
             Destroy();
         }
 
-        m_VertexCount = data.size();
+        m_VertexCount = vertices.size();
         m_PrimType = type;
         m_UsageHint = usage;
+        // only becomes true once the indices are on the device as well
+        m_IsIndexed = false;
+        m_Bounds = bounds;
 
-        auto isDynamicUsage = usage == core::runtime::graphics::BufferUsageHint::BUFFER_USAGE_HINT_DYNAMIC || usage == core::runtime::graphics::BufferUsageHint::BUFFER_USAGE_HINT_STREAM;
+        if (m_VertexCount == 0) return true;
 
-        if (m_VertexCount == 0) return;
+        if (m_VertexBuffer == nullptr && !CreateDeviceBuffer(vertices.size())) {
+            return false;
+        }
 
-        const size_t bufferSize = data.size() * sizeof(core::runtime::graphics::Vertex);
-        HRESULT hr;
+        // dynamic contents are re-uploaded by their owner every frame anyway, so only static data is shadowed
+        if ((m_ResourceRegistry || isIndexed) && usage == core::runtime::graphics::BufferUsageHint::BUFFER_USAGE_HINT_STATIC) {
+            m_ShadowData = vertices;
+        } else if (!m_ShadowData.empty()) {
+            m_ShadowData.clear();
+            m_ShadowData.shrink_to_fit();
+        }
 
-        if (m_VertexBuffer == nullptr) {
-            DWORD dxUsage = D3DUSAGE_WRITEONLY;
+        return WriteVertices(vertices);
+    }
 
-            if(isDynamicUsage) {
-                dxUsage |= D3DUSAGE_DYNAMIC;
-            }
+    bool D3D9VertexBuffer::UploadIndices(std::vector<uint32_t> indices) {
+        // 32-bit indices are only used when the mesh doesn't fit 16-bit ones, older hardware may not support them
+        bool use32BitIndices = m_VertexCount > 0xFFFF;
+        if (m_IndexBuffer && (indices.size() > m_IndexCapacity || use32BitIndices != m_Use32BitIndices)) {
+            ReleaseIndexBuffer();
+        }
 
-            hr = m_Device->CreateVertexBuffer(
-                    bufferSize,
-                    dxUsage,
-                    0,
-                    D3DPOOL_DEFAULT,
-                    &m_VertexBuffer,
-                    nullptr
-            );
-
-            if (FAILED(hr)) {
-                g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_ERROR, "Failed to create vertex buffer! Error: 0x%08x", hr);
-                m_VertexBuffer = nullptr;
-                return;
-            } else {
-                m_BufferCapacity = data.size();
-                g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_INFO, "Vertex buffer created successfully");
+        m_Use32BitIndices = use32BitIndices;
+
+        if (m_IndexBuffer == nullptr && !CreateIndexBuffer(indices.size())) {
+            return false;
+        }
+
+        if (!WriteIndices(indices)) {
+            return false;
+        }
+
+        m_IndexCount = indices.size();
+        m_Indices = std::move(indices);
+        m_IsIndexed = true;
+
+        return true;
+    }
+
+    bool D3D9VertexBuffer::CreateDeviceBuffer(size_t capacity) {
+        auto isDynamicUsage = m_UsageHint == core::runtime::graphics::BufferUsageHint::BUFFER_USAGE_HINT_DYNAMIC || m_UsageHint == core::runtime::graphics::BufferUsageHint::BUFFER_USAGE_HINT_STREAM;
+
+        DWORD dxUsage = D3DUSAGE_WRITEONLY;
+
+        if(isDynamicUsage) {
+            dxUsage |= D3DUSAGE_DYNAMIC;
+        }
+
+        HRESULT hr = m_Device->CreateVertexBuffer(
+                capacity * sizeof(core::runtime::graphics::Vertex),
+                dxUsage,
+                0,
+                D3DPOOL_DEFAULT,
+                &m_VertexBuffer,
+                nullptr
+        );
+
+        if (FAILED(hr)) {
+            g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_ERROR, "Failed to create vertex buffer! Error: 0x%08x", hr);
+            m_VertexBuffer = nullptr;
+            return false;
+        }
+
+        m_BufferCapacity = capacity;
+        g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_INFO, "Vertex buffer created successfully");
+
+        if (m_ResourceRegistry) {
+            m_ResourceRegistry->Register(this);
+        }
+
+        return true;
+    }
+
+    bool D3D9VertexBuffer::CreateIndexBuffer(size_t capacity) {
+        const size_t indexSize = m_Use32BitIndices ? sizeof(uint32_t) : sizeof(uint16_t);
+
+        HRESULT hr = m_Device->CreateIndexBuffer(
+                capacity * indexSize,
+                D3DUSAGE_WRITEONLY,
+                m_Use32BitIndices ? D3DFMT_INDEX32 : D3DFMT_INDEX16,
+                D3DPOOL_DEFAULT,
+                &m_IndexBuffer,
+                nullptr
+        );
+
+        if (FAILED(hr)) {
+            g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_ERROR, "Failed to create index buffer! Error: 0x%08x", hr);
+            m_IndexBuffer = nullptr;
+            return false;
+        }
+
+        m_IndexCapacity = capacity;
+        return true;
+    }
+
+    bool D3D9VertexBuffer::WriteIndices(const std::vector<uint32_t> &indices) {
+        const size_t indexSize = m_Use32BitIndices ? sizeof(uint32_t) : sizeof(uint16_t);
+
+        void *indexData;
+        HRESULT hr = m_IndexBuffer->Lock(0, indices.size() * indexSize, &indexData, 0);
+
+        if (FAILED(hr)) {
+            g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_ERROR, "Failed to lock index buffer! Error: 0x%08x", hr);
+            return false;
+        }
+
+        if (m_Use32BitIndices) {
+            memcpy(indexData, indices.data(), indices.size() * sizeof(uint32_t));
+        } else {
+            auto shortIndices = static_cast<uint16_t *>(indexData);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                shortIndices[i] = static_cast<uint16_t>(indices[i]);
             }
         }
 
+        m_IndexBuffer->Unlock();
+        return true;
+    }
+
+    void D3D9VertexBuffer::ReleaseIndexBuffer() {
+        if (m_IndexBuffer) {
+            m_IndexBuffer->Release();
+            m_IndexBuffer = nullptr;
+        }
+
+        m_IndexCapacity = 0;
+    }
+
+    bool D3D9VertexBuffer::WriteVertices(const std::vector<core::runtime::graphics::Vertex> &data) {
+        const size_t bufferSize = data.size() * sizeof(core::runtime::graphics::Vertex);
+
         core::runtime::graphics::Vertex *vertexData;
-        hr = m_VertexBuffer->Lock(0, bufferSize, reinterpret_cast<void **>(&vertexData), D3DLOCK_DISCARD);
+        HRESULT hr = m_VertexBuffer->Lock(0, bufferSize, reinterpret_cast<void **>(&vertexData), D3DLOCK_DISCARD);
 
-        if (SUCCEEDED(hr)) {
-            memcpy(vertexData, data.data(), bufferSize);
-            m_VertexBuffer->Unlock();
+        if (FAILED(hr)) {
+            g_LoggerD3D9VertexBuffer.Log(runtime::LOG_LEVEL_ERROR, "Failed to lock vertex buffer! Error: 0x%08x", hr);
+            return false;
         }
+
+        memcpy(vertexData, data.data(), bufferSize);
+        m_VertexBuffer->Unlock();
+
+        return true;
+    }
+
+    void D3D9VertexBuffer::OnDeviceLost() {
+        if (m_VertexBuffer) {
+            m_VertexBuffer->Release();
+            m_VertexBuffer = nullptr;
+        }
+
+        if (m_IndexBuffer) {
+            m_IndexBuffer->Release();
+            m_IndexBuffer = nullptr;
+        }
+    }
+
+    bool D3D9VertexBuffer::OnDeviceReset() {
+        if (m_BufferCapacity == 0) {
+            return true;
+        }
+
+        if (!CreateDeviceBuffer(m_BufferCapacity)) {
+            return false;
+        }
+
+        if (m_IsIndexed && m_IndexCapacity > 0) {
+            if (!CreateIndexBuffer(m_IndexCapacity) || !WriteIndices(m_Indices)) {
+                return false;
+            }
+        }
+
+        if (!m_ShadowData.empty()) {
+            return WriteVertices(m_ShadowData);
+        }
+
+        // nothing to restore from; don't draw stale memory until the owner uploads again
+        m_VertexCount = 0;
+        return true;
     }
 
     size_t D3D9VertexBuffer::Size() {
-        return m_VertexCount;
+        // an optimized mesh still counts the vertices the owner uploaded, not the unique ones
+        return m_IsIndexed ? m_IndexCount : m_VertexCount;
     }
 
     core::runtime::graphics::PrimitiveType D3D9VertexBuffer::GetPrimitiveType() {
@@ -157,6 +404,19 @@ namespace engine::backend::dx9 {
         std::vector<core::runtime::graphics::Vertex> result;
         if (!m_VertexBuffer || m_VertexCount == 0) return result;
 
+        // optimized meshes are expanded back into a triangle list; the triangle order may differ from the upload
+        if (m_IsIndexed) {
+            result.reserve(m_Indices.size());
+            for (auto index: m_Indices) {
+                result.push_back(m_ShadowData[index]);
+            }
+
+            return result;
+        }
+
+        // reading the shadow copy avoids locking a write-only buffer
+        if (m_ShadowData.size() == m_VertexCount) return m_ShadowData;
+
         const size_t bufferSize = m_VertexCount * sizeof(core::runtime::graphics::Vertex);
         result.resize(m_VertexCount);
 
@@ -0,0 +1,10 @@
+#pragma once
+
+// forward definition of D3D9 types
+struct IDirect3DDevice9;
+struct IDirect3DVertexDeclaration9;
+
+namespace engine::backend::dx9 {
+    // declaration matching core::runtime::graphics::Vertex, created on first use
+    IDirect3DVertexDeclaration9 *D3D9_GetVertexDeclaration(IDirect3DDevice9 *device);
+}
@@ -1,13 +1,33 @@
 #pragma once
 
 #include <Engine/Core/Runtime/Graphics/IGraphicsBackend.hpp>
+#include <Engine/Backend/D3D9/D3D9_Frame.hpp>
+
+#include <cstdint>
+#include <vector>
 
 // forward definition of D3D9 types
 struct IDirect3DDevice9;
+struct IDirect3DSurface9;
+struct _D3DPRESENT_PARAMETERS_;
 
 namespace engine::backend::dx9 {
-    struct D3D9Backend : public core::runtime::graphics::IGraphicsBackend {
-        D3D9Backend(IDirect3DDevice9 *device) : h_D3D9Device{device} {}
+    struct D3D9OcclusionQueryPool;
+    struct D3D9RenderTargetPool;
+    struct D3D9TextureBudget;
+    struct D3D9ResourceRegistry;
+    struct D3D9ShaderPack;
+    struct D3D9ShaderConstants;
+    struct D3D9UniformBlock;
+    struct D3D9ShaderVariantSet;
+    struct D3D9SpriteBatch;
+    struct D3D9Texture;
+
+    struct D3D9Backend : public core::runtime::graphics::IGraphicsBackend, public D3D9FrameBackend {
+        // defined out of line, the subsystem types are incomplete here
+        D3D9Backend(IDirect3DDevice9 *device);
+
+        ~D3D9Backend();
 
         bool Initialize() override;
 
@@ -27,8 +47,27 @@ namespace engine::backend::dx9 {
 
         core::runtime::graphics::BackendFeature GetActiveFeatures() override;
 
+        // clears color and, if a depth buffer is bound, depth
         void Clear(core::runtime::graphics::Color color) override;
 
+        // Depth and stencil are only cleared when the bound depth buffer has them, asking for them without one
+        // is not an error. Returns false if the device rejected the clear.
+        bool Clear(const D3D9ClearDesc &desc) override;
+
+        // Starts a frame: applies the default render state if the device doesn't have it yet, advances the
+        // per-frame subsystems (occlusion queries, render target pool, texture budget, constant statistics),
+        // clears as described and begins the device scene. Use CLEAR_NONE for targets the frame fully overwrites.
+        // The default state leaves the depth test off; the depth clear is for passes that turn it on.
+        // Does nothing but open the frame while the device is lost.
+        void BeginFrame(const D3D9ClearDesc &clear = {}) override;
+
+        // ends the device scene opened by BeginFrame; call it before presenting
+        void EndFrame() override;
+
+        uint64_t GetFrameIndex() const {
+            return m_FrameIndex;
+        }
+
         std::unique_ptr<core::runtime::graphics::IVertexBuffer> CreateVertexBuffer() override;
 
         std::unique_ptr<core::runtime::graphics::IShader> CreateShader() override;
@@ -37,8 +76,93 @@ namespace engine::backend::dx9 {
 
         std::unique_ptr<core::runtime::graphics::ITexture> CreateTexture() override;
 
+        // Creates a shader straight from the bytecode of a mapped shader pack; returns NULL if it isn't in the pack.
+        // The shader reads its uniforms from the pack's constant records, so the pack must outlive it.
+        std::unique_ptr<core::runtime::graphics::IShader> CreateShaderFromPack(const D3D9ShaderPack &pack, std::string_view name);
+
+        std::unique_ptr<D3D9SpriteBatch> CreateSpriteBatch(size_t maxQuads = 4096);
+
+        std::unique_ptr<D3D9ShaderVariantSet> CreateShaderVariantSet(
+                std::string source,
+                core::runtime::graphics::ShaderType type,
+                std::vector<std::string> keywords
+        );
+
+        // the block is not bound yet, see D3D9ShaderConstants::BindBlock
+        std::unique_ptr<D3D9UniformBlock> CreateUniformBlock(uint32_t stages, uint32_t baseRegister, uint32_t registerCount);
+
+        // redirects rendering into the given targets; either one can be NULL to keep the current binding
+        bool SetRenderTarget(D3D9Texture *color, D3D9Texture *depth);
+
+        // switches back to the back buffer and the device's own depth buffer
+        void ResetRenderTarget();
+
+        // Checks for a lost device and recovers from it. Video memory resources are released as soon as the loss
+        // is noticed and re-created once the device accepts a Reset with the given parameters.
+        // Returns true when the device can be rendered to. When the application resets the device itself (after a
+        // call that released the resources), the next call restores them.
+        bool HandleDeviceLost(_D3DPRESENT_PARAMETERS_ *presentParameters);
+
+        bool IsDeviceLost() const {
+            return m_IsDeviceLost;
+        }
+
+        // enables upload-time vertex cache and fetch optimization for vertex buffers created afterwards
+        void SetMeshOptimization(bool enabled) {
+            m_OptimizeMeshes = enabled;
+        }
+
+        D3D9OcclusionQueryPool *GetOcclusionQueries() const {
+            return m_OcclusionQueries.get();
+        }
+
+        D3D9RenderTargetPool *GetRenderTargetPool() const {
+            return m_RenderTargetPool.get();
+        }
+
+        D3D9TextureBudget *GetTextureBudget() const {
+            return m_TextureBudget.get();
+        }
+
+        D3D9ResourceRegistry *GetResourceRegistry() const {
+            return m_ResourceRegistry.get();
+        }
+
+        D3D9ShaderConstants *GetShaderConstants() const {
+            return m_ShaderConstants.get();
+        }
+
     protected:
+        // cull mode, clipping, lighting and depth test; set once instead of on every clear
+        void ApplyDefaultState();
+
+        // re-creates the released resources and device state after a successful Reset
+        bool RestoreDevice();
+
+        // re-reads the format of the bound depth buffer, after anything that may have changed it
+        void UpdateDepthFormat();
+
         IDirect3DDevice9 *h_D3D9Device;
         uint32_t m_ActiveFeatures = 0;
+
+        std::unique_ptr<D3D9OcclusionQueryPool> m_OcclusionQueries;
+        std::unique_ptr<D3D9RenderTargetPool> m_RenderTargetPool;
+        std::unique_ptr<D3D9TextureBudget> m_TextureBudget;
+        std::unique_ptr<D3D9ResourceRegistry> m_ResourceRegistry;
+        std::unique_ptr<D3D9ShaderConstants> m_ShaderConstants;
+        bool m_IsDeviceLost = false;
+        bool m_OptimizeMeshes = false;
+
+        bool m_DefaultStateApplied = false;
+        bool m_InFrame = false;
+        // BeginScene succeeded and EndScene is still due
+        bool m_InScene = false;
+        uint64_t m_FrameIndex = 0;
+        // D3DFMT_UNKNOWN without a depth buffer
+        uint32_t m_DepthFormat = 0;
+
+        // the device's default targets, saved the first time rendering is redirected
+        IDirect3DSurface9 *m_BackBufferSurface = nullptr;
+        IDirect3DSurface9 *m_BackBufferDepthSurface = nullptr;
     };
 }
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <span>
+
+#include <glm/glm.hpp>
+#include <Engine/Core/Runtime/Graphics/IVertexBuffer.hpp>
+
+namespace engine::backend::dx9 {
+    struct D3D9BoundingVolume {
+        glm::vec3 m_Min;
+        glm::vec3 m_Max;
+
+        // sphere around the box center; usually tighter than the box diagonal for round objects
+        glm::vec3 m_Center;
+        float m_Radius;
+
+        // false for buffers without vertices, which never pass a culling test
+        bool m_IsValid;
+
+        // the extent isn't known, e.g. for dynamic buffers whose owner never set bounds; always passes a culling test
+        bool m_IsUnknown;
+    };
+
+    // bounds of something that may be anywhere
+    inline D3D9BoundingVolume D3D9_UnknownBounds() {
+        D3D9BoundingVolume bounds{};
+        bounds.m_IsUnknown = true;
+
+        return bounds;
+    }
+
+    // Computes the axis aligned box and bounding sphere of the vertex positions, using SSE where available.
+    D3D9BoundingVolume D3D9_ComputeBounds(std::span<const core::runtime::graphics::Vertex> vertices);
+
+    // Moves object space bounds into the space of the given (column-major) matrix. The box is the box around the
+    // transformed box, the sphere radius is scaled by the largest axis scale.
+    D3D9BoundingVolume D3D9_TransformBounds(const D3D9BoundingVolume &bounds, const glm::mat4 &transform);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Engine/Core/Runtime/Graphics/IGraphicsBackend.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace engine::backend::dx9 {
+    enum D3D9ClearFlags : uint32_t {
+        // nothing to clear, e.g. when the frame overwrites every pixel anyway
+        CLEAR_NONE = 0,
+        CLEAR_COLOR = 1 << 0,
+        CLEAR_DEPTH = 1 << 1,
+        CLEAR_STENCIL = 1 << 2,
+        CLEAR_ALL = CLEAR_COLOR | CLEAR_DEPTH | CLEAR_STENCIL
+    };
+
+    // in pixels of the current render target, right and bottom are exclusive
+    struct D3D9ClearRect {
+        int32_t m_Left;
+        int32_t m_Top;
+        int32_t m_Right;
+        int32_t m_Bottom;
+    };
+
+    struct D3D9ClearDesc {
+        uint32_t m_Flags = CLEAR_COLOR | CLEAR_DEPTH;
+        core::runtime::graphics::Color m_Color{};
+        float m_Depth = 1.0f;
+        uint32_t m_Stencil = 0;
+        // empty clears the whole viewport
+        std::vector<D3D9ClearRect> m_Rects;
+    };
+
+    // The frame API of the D3D9 backends, which IGraphicsBackend doesn't have. Implemented by D3D9Backend, and by
+    // D3D9NullBackend and D3D9FrameTraceBackend so traces can record and replay it without a device.
+    struct D3D9FrameBackend {
+        virtual ~D3D9FrameBackend() = default;
+
+        // returns false if the clear was rejected
+        virtual bool Clear(const D3D9ClearDesc &desc) = 0;
+
+        virtual void BeginFrame(const D3D9ClearDesc &clear = {}) = 0;
+
+        virtual void EndFrame() = 0;
+    };
+}
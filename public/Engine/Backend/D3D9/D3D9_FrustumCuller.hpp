@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <Engine/Backend/D3D9/D3D9_Bounds.hpp>
+
+namespace engine::backend::dx9 {
+    struct D3D9FrustumCullerStats {
+        size_t m_Tested;
+        size_t m_Visible;
+        double m_CullTimeMs;
+    };
+
+    // Tests many bounding volumes against a view frustum at once. Volumes are stored as structure of arrays,
+    // so every plane test handles four objects per SSE instruction. Each object is tested with both its sphere
+    // and its box projected onto the plane normal, whichever is tighter.
+    // Typical use: Clear, Add the world space bounds of every draw, Cull, then submit only the visible ones.
+    // Unknown bounds are always visible, empty ones never are.
+    struct D3D9FrustumCuller {
+        void Clear();
+
+        void Reserve(size_t count);
+
+        // returns the index that identifies the object in the Cull output
+        uint32_t Add(const D3D9BoundingVolume &bounds);
+
+        size_t Size() const {
+            return m_Count;
+        }
+
+        // Writes the indices of all objects intersecting the frustum of the (column-major) view-projection matrix,
+        // in the order they were added. The near plane follows the OpenGL convention, which is a conservative
+        // superset of the Direct3D one, so either kind of projection matrix works.
+        size_t Cull(const glm::mat4 &viewProjection, std::vector<uint32_t> &visible);
+
+        const D3D9FrustumCullerStats &GetStats() const {
+            return m_Stats;
+        }
+
+    protected:
+        // SoA arrays, padded to a multiple of 4 with volumes that are always rejected
+        std::vector<float> m_CenterX;
+        std::vector<float> m_CenterY;
+        std::vector<float> m_CenterZ;
+        std::vector<float> m_ExtentX;
+        std::vector<float> m_ExtentY;
+        std::vector<float> m_ExtentZ;
+        std::vector<float> m_Radius;
+
+        size_t m_Count = 0;
+        D3D9FrustumCullerStats m_Stats{};
+    };
+}
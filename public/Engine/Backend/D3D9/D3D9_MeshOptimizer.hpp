@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <Engine/Core/Runtime/Graphics/IVertexBuffer.hpp>
+
+namespace engine::backend::dx9 {
+    // FIFO size used when simulating the post-transform cache; a conservative value for D3D9-era hardware
+    static constexpr size_t D3D9_VERTEX_CACHE_SIZE = 16;
+
+    struct D3D9VertexCacheStats {
+        size_t m_TriangleCount;
+        // vertices referenced by the index buffer
+        size_t m_VertexCount;
+        // vertex shader invocations with the simulated cache
+        size_t m_TransformedVertices;
+        // average cache miss ratio: transformed vertices per triangle, 3.0 for an unindexed list
+        double m_ACMR;
+        // average transform to vertex ratio: 1.0 means every vertex is transformed exactly once
+        double m_ATVR;
+    };
+
+    struct D3D9MeshOptimizationStats {
+        D3D9VertexCacheStats m_Before;
+        D3D9VertexCacheStats m_After;
+        double m_OptimizeTimeMs;
+    };
+
+    // The functions below only work on system memory, so they can be used headlessly (e.g. by tools or tests).
+
+    // Turns a triangle list into unique vertices plus indices, merging vertices that are bitwise identical.
+    void D3D9_BuildIndexedMesh(
+            const std::vector<core::runtime::graphics::Vertex> &source,
+            std::vector<core::runtime::graphics::Vertex> &vertices,
+            std::vector<uint32_t> &indices
+    );
+
+    // Reorders triangles for the post-transform vertex cache (Tom Forsyth's linear-speed algorithm).
+    void D3D9_OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount);
+
+    // Reorders vertices in the order they are first referenced, so fetches walk the buffer linearly.
+    // Unreferenced vertices are dropped and the indices are remapped.
+    void D3D9_OptimizeVertexFetch(std::vector<core::runtime::graphics::Vertex> &vertices, std::span<uint32_t> indices);
+
+    D3D9VertexCacheStats D3D9_AnalyzeVertexCache(
+            std::span<const uint32_t> indices,
+            size_t vertexCount,
+            size_t cacheSize = D3D9_VERTEX_CACHE_SIZE
+    );
+
+    // Runs the full pipeline on a triangle list: indexing, cache and fetch reordering.
+    // Returns false if the mesh can't be optimized (no full triangles).
+    bool D3D9_OptimizeMesh(
+            const std::vector<core::runtime::graphics::Vertex> &source,
+            std::vector<core::runtime::graphics::Vertex> &vertices,
+            std::vector<uint32_t> &indices,
+            D3D9MeshOptimizationStats *stats = nullptr
+    );
+}
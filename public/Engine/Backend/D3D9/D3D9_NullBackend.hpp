@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Engine/Core/Runtime/Graphics/IGraphicsBackend.hpp>
+#include <Engine/Backend/D3D9/D3D9_Frame.hpp>
+
+#include <cstdint>
+
+namespace engine::backend::dx9 {
+    // Graphics backend that accepts every call without a device. Resources only keep what their queries return
+    // (uploaded vertices, shader source, bitmaps), nothing is ever drawn. Used to replay traces on machines
+    // without Direct3D, to measure the cost of the calling code alone, and by the tests.
+    struct D3D9NullBackend : public core::runtime::graphics::IGraphicsBackend, public D3D9FrameBackend {
+        bool Initialize() override;
+
+        void Shutdown() override;
+
+        std::string GetName() const override;
+
+        std::string GetIdentifier() const override;
+
+        void SetViewport(core::math::Vector2 pos, core::math::Vector2 size) override;
+
+        void SetScissor(core::math::Vector2 start, core::math::Vector2 size) override;
+
+        void EnableFeatures(core::runtime::graphics::BackendFeature featuresMask) override;
+
+        void DisableFeatures(core::runtime::graphics::BackendFeature featuresMask) override;
+
+        core::runtime::graphics::BackendFeature GetActiveFeatures() override;
+
+        void Clear(core::runtime::graphics::Color color) override;
+
+        bool Clear(const D3D9ClearDesc &desc) override;
+
+        void BeginFrame(const D3D9ClearDesc &clear = {}) override;
+
+        void EndFrame() override;
+
+        std::unique_ptr<core::runtime::graphics::IVertexBuffer> CreateVertexBuffer() override;
+
+        std::unique_ptr<core::runtime::graphics::IShader> CreateShader() override;
+
+        std::unique_ptr<core::runtime::graphics::IShaderProgram> CreateShaderProgram() override;
+
+        std::unique_ptr<core::runtime::graphics::ITexture> CreateTexture() override;
+
+    protected:
+        uint32_t m_ActiveFeatures = 0;
+    };
+}
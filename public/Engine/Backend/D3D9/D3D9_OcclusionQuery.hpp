@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <Engine/Backend/D3D9/D3D9_ResourceRegistry.hpp>
+
+// forward definition of D3D9 types
+struct IDirect3DDevice9;
+struct IDirect3DQuery9;
+
+namespace engine::backend::dx9 {
+    // identifies an object whose visibility is tracked by the occlusion query pool
+    using D3D9OcclusionObjectId = uint32_t;
+
+    // Pooled D3DQUERYTYPE_OCCLUSION queries with non-blocking result collection.
+    // Usage per frame: BeginFrame(), then for every tracked object draw its bounding proxy between
+    // BeginQuery()/EndQuery() inside a BeginProxyPass()/EndProxyPass() block, and skip the real draw
+    // when IsVisible() returns false. Results arrive one or two frames later.
+    // D3D9Backend::BeginFrame calls BeginFrame(); a pool used without it must be advanced by its owner, otherwise
+    // no result is collected and no query returns to the pool.
+    struct D3D9OcclusionQueryPool : public D3D9DeviceResource {
+        explicit D3D9OcclusionQueryPool(IDirect3DDevice9 *device) : m_Device(device) {}
+
+        ~D3D9OcclusionQueryPool() {
+            Destroy();
+        }
+
+        bool Create();
+
+        void Destroy();
+
+        // collects the results of finished queries without stalling on the GPU
+        void BeginFrame();
+
+        // disables color and depth writes while keeping the depth test on, so proxies don't touch the frame
+        void BeginProxyPass();
+
+        void EndProxyPass();
+
+        // returns false if the object still has a query in flight; in that case nothing must be drawn for it
+        bool BeginQuery(D3D9OcclusionObjectId id);
+
+        void EndQuery();
+
+        // last known visibility; objects without a (recent enough) result are treated as visible
+        bool IsVisible(D3D9OcclusionObjectId id) const;
+
+        void Forget(D3D9OcclusionObjectId id);
+
+        // queries are simply dropped; new ones are created on demand after the reset
+        void OnDeviceLost() override {
+            Destroy();
+        }
+
+        bool OnDeviceReset() override {
+            return true;
+        }
+
+        void SetVisiblePixelThreshold(uint32_t pixels) {
+            m_VisiblePixelThreshold = pixels;
+        }
+
+        // number of frames a result stays valid before the object falls back to being visible
+        void SetMaxResultAge(uint32_t frames) {
+            m_MaxResultAge = frames;
+        }
+
+        bool IsSupported() const {
+            return m_Supported;
+        }
+
+        size_t GetPendingQueryCount() const {
+            return m_PendingQueries.size();
+        }
+
+        size_t GetPooledQueryCount() const {
+            return m_FreeQueries.size();
+        }
+
+    protected:
+        struct ObjectState {
+            bool m_Visible = true;
+            bool m_QueryInFlight = false;
+            uint64_t m_ResultFrame = 0;
+            // generation of the query in flight; an id that was forgotten and reused starts a new one
+            uint64_t m_Generation = 0;
+        };
+
+        struct PendingQuery {
+            IDirect3DQuery9 *m_Query;
+            D3D9OcclusionObjectId m_ObjectId;
+            uint64_t m_Generation;
+        };
+
+        IDirect3DQuery9 *AcquireQuery();
+
+        void RecycleQuery(IDirect3DQuery9 *query);
+
+        IDirect3DDevice9 *m_Device;
+        bool m_Supported = false;
+
+        uint64_t m_FrameIndex = 0;
+        uint64_t m_NextGeneration = 0;
+        uint32_t m_VisiblePixelThreshold = 0;
+        uint32_t m_MaxResultAge = 4;
+
+        std::vector<IDirect3DQuery9 *> m_FreeQueries;
+        std::vector<PendingQuery> m_PendingQueries;
+        std::unordered_map<D3D9OcclusionObjectId, ObjectState> m_Objects;
+
+        // query currently recording between BeginQuery and EndQuery
+        IDirect3DQuery9 *m_ActiveQuery = nullptr;
+
+        // render states saved by BeginProxyPass
+        unsigned long m_SavedColorWrite = 0;
+        unsigned long m_SavedZWrite = 0;
+        unsigned long m_SavedZEnable = 0;
+    };
+}
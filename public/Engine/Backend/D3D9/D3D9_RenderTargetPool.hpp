@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <Engine/Backend/D3D9/D3D9_Texture.hpp>
+#include <Engine/Backend/D3D9/D3D9_ResourceRegistry.hpp>
+
+// forward definition of D3D9 types
+struct IDirect3DDevice9;
+struct IDirect3DSurface9;
+
+namespace engine::backend::dx9 {
+    // Per-frame pool of transient render targets keyed by size and format. Passes acquire a target,
+    // render into it and release it once consumed, so later passes of the same frame reuse the surface.
+    // Targets left unused for a few frames are freed, keeping post-processing VRAM constant.
+    // D3D9Backend::BeginFrame calls BeginFrame(); a pool used without it must be advanced by its owner, otherwise
+    // released targets are never reused by a later frame and idle ones are never freed.
+    struct D3D9RenderTargetPool : public D3D9DeviceResource {
+        // pooled targets count towards the texture budget, if any, but are never evicted
+        explicit D3D9RenderTargetPool(IDirect3DDevice9 *device, D3D9TextureBudget *textureBudget = nullptr) :
+                m_Device(device),
+                m_TextureBudget(textureBudget) {}
+
+        ~D3D9RenderTargetPool() {
+            Destroy();
+        }
+
+        void Destroy();
+
+        // returns every target to the pool and frees the ones idle for too long
+        void BeginFrame();
+
+        D3D9Texture *Acquire(uint32_t width, uint32_t height, D3D9TextureFormat format);
+
+        void Release(D3D9Texture *texture);
+
+        // system memory surfaces used by D3D9Texture::Download to read render targets back
+        IDirect3DSurface9 *AcquireReadbackSurface(uint32_t width, uint32_t height, D3D9TextureFormat format);
+
+        void ReleaseReadbackSurface(IDirect3DSurface9 *surface);
+
+        // pooled targets keep their identity across a reset, only their surfaces are re-created
+        void OnDeviceLost() override;
+
+        bool OnDeviceReset() override;
+
+        void SetMaxIdleFrames(uint32_t frames) {
+            m_MaxIdleFrames = frames;
+        }
+
+        size_t GetTargetCount() const {
+            return m_Targets.size();
+        }
+
+        size_t GetAllocatedBytes() const;
+
+    protected:
+        struct PooledTarget {
+            std::unique_ptr<D3D9Texture> m_Texture;
+            uint32_t m_Width;
+            uint32_t m_Height;
+            D3D9TextureFormat m_Format;
+            bool m_InUse;
+            uint64_t m_LastUsedFrame;
+        };
+
+        struct PooledSurface {
+            IDirect3DSurface9 *m_Surface;
+            uint32_t m_Width;
+            uint32_t m_Height;
+            D3D9TextureFormat m_Format;
+            bool m_InUse;
+            uint64_t m_LastUsedFrame;
+        };
+
+        IDirect3DDevice9 *m_Device;
+        D3D9TextureBudget *m_TextureBudget;
+
+        uint64_t m_FrameIndex = 0;
+        uint32_t m_MaxIdleFrames = 3;
+
+        std::vector<PooledTarget> m_Targets;
+        std::vector<PooledSurface> m_ReadbackSurfaces;
+    };
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+
+namespace engine::backend::dx9 {
+    // Implemented by everything that owns D3DPOOL_DEFAULT objects (or other state dropped by IDirect3DDevice9::Reset).
+    struct D3D9DeviceResource {
+        virtual ~D3D9DeviceResource() = default;
+
+        // release every video memory object; the device can't be used anymore at this point
+        virtual void OnDeviceLost() = 0;
+
+        // re-create the objects released by OnDeviceLost, after a successful Reset
+        virtual bool OnDeviceReset() = 0;
+
+        // the registry is being destroyed before this resource; resources keeping a pointer to it must drop it
+        virtual void OnRegistryDestroyed() {}
+    };
+
+    struct D3D9RecoveryStats {
+        size_t m_ResourceCount;
+        size_t m_FailedCount;
+        double m_ReleaseTimeMs;
+        double m_RestoreTimeMs;
+    };
+
+    struct D3D9ResourceRegistry {
+        D3D9ResourceRegistry() = default;
+
+        D3D9ResourceRegistry(const D3D9ResourceRegistry &) = delete;
+
+        D3D9ResourceRegistry &operator=(const D3D9ResourceRegistry &) = delete;
+
+        ~D3D9ResourceRegistry();
+
+        void Register(D3D9DeviceResource *resource) {
+            m_Resources.insert(resource);
+        }
+
+        void Unregister(D3D9DeviceResource *resource) {
+            m_Resources.erase(resource);
+        }
+
+        void ReleaseAll();
+
+        bool RestoreAll();
+
+        size_t GetResourceCount() const {
+            return m_Resources.size();
+        }
+
+        const D3D9RecoveryStats &GetLastRecoveryStats() const {
+            return m_LastRecovery;
+        }
+
+    protected:
+        std::unordered_set<D3D9DeviceResource *> m_Resources;
+        D3D9RecoveryStats m_LastRecovery{};
+    };
+}
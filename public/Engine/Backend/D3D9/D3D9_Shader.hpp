@@ -1,6 +1,14 @@
 #pragma once
 
 #include <Engine/Core/Runtime/Graphics/IShader.hpp>
+#include <Engine/Backend/D3D9/D3D9_ShaderPack.hpp>
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 // forward definition of D3D9 types
 struct IDirect3DDevice9;
@@ -8,11 +16,32 @@ struct ID3DXBuffer;
 struct ID3DXConstantTable;
 
 namespace engine::backend::dx9 {
+    // preprocessor definitions passed to the HLSL compiler, as name/value pairs
+    using D3D9ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+    // compiles HLSL into bytecode with D3DCompile, without touching any device; safe to call from worker threads
+    bool D3D9_CompileShaderBytecode(
+            std::string_view source,
+            core::runtime::graphics::ShaderType type,
+            const D3D9ShaderDefines &defines,
+            std::vector<unsigned char> &bytecode,
+            std::string &log
+    );
+
+    // where a uniform lives, as reported by the D3DX constant table or stored in a shader pack
+    struct D3D9ShaderConstantInfo {
+        uint32_t m_RegisterSet = 0; // D3DXREGISTER_SET
+        uint32_t m_RegisterIndex = 0;
+        uint32_t m_RegisterCount = 0;
+        uint32_t m_Class = 0; // D3DXPARAMETER_CLASS
+    };
+
     struct D3D9Shader : public core::runtime::graphics::IShader {
         explicit D3D9Shader(IDirect3DDevice9 *device) : m_Device(device),
                                               m_ShaderHandle(nullptr),
                                               m_CompiledShader(nullptr),
                                               m_ErrorBuffer(nullptr),
+                                              m_ConstantTable(nullptr),
                                               m_ShaderType(core::runtime::graphics::ShaderType::SHADER_TYPE_UNKNOWN) {}
 
         ~D3D9Shader() {
@@ -25,6 +54,11 @@ namespace engine::backend::dx9 {
 
         void SetSource(std::string_view source, core::runtime::graphics::ShaderType type) override;
 
+        // defines applied on the next Compile
+        void SetDefines(D3D9ShaderDefines defines) {
+            m_Defines = std::move(defines);
+        }
+
         std::string GetSource() override;
 
         std::string GetCompileLog() override;
@@ -33,6 +67,19 @@ namespace engine::backend::dx9 {
 
         bool UseCompiledShader(const std::span<unsigned char> &data, core::runtime::graphics::ShaderType type) override;
 
+        // Uses the constants reflected by the shader packer instead of parsing the bytecode's constant table.
+        // The shader only keeps views of the pack's constant records and string table, so the pack must outlive it.
+        bool UseCompiledShader(
+                const std::span<unsigned char> &data,
+                core::runtime::graphics::ShaderType type,
+                std::span<const D3D9ShaderPackConstant> constants,
+                std::string_view strings
+        );
+
+        // Shares the device shader and constants of an already created shader instead of creating them again.
+        // Both hold their own references, so either one can be destroyed first.
+        bool UseSharedShader(const D3D9Shader &shader);
+
         std::span<unsigned char> GetCompiledShader() override;
 
         core::runtime::graphics::ShaderCapsFlags GetImplCapabilities() const override {
@@ -51,7 +98,12 @@ namespace engine::backend::dx9 {
             return m_ConstantTable;
         }
 
+        // looks the uniform up in the reflected constants, or in the constant table when there are none
+        bool FindConstant(std::string_view name, D3D9ShaderConstantInfo &info) const;
+
     protected:
+        bool CreateShaderObject(const std::span<unsigned char> &data, core::runtime::graphics::ShaderType type);
+
         IDirect3DDevice9 *m_Device;
 
         ID3DXBuffer *m_CompiledShader;
@@ -62,5 +114,11 @@ namespace engine::backend::dx9 {
 
         core::runtime::graphics::ShaderType m_ShaderType;
         std::string m_SourceCode;
+        D3D9ShaderDefines m_Defines;
+
+        // set for shaders created from a shader pack, both point into the pack
+        bool m_HasReflectedConstants = false;
+        std::span<const D3D9ShaderPackConstant> m_ReflectedConstants;
+        std::string_view m_ReflectedStrings;
     };
 }
\ No newline at end of file
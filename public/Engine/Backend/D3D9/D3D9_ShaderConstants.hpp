@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <Engine/Core/Runtime/Graphics/IShader.hpp>
+
+// forward definition of D3D9 types
+struct IDirect3DDevice9;
+
+namespace engine::backend::dx9 {
+    struct D3D9ShaderConstantStats {
+        uint64_t m_Flushes;
+        // Set*ShaderConstantF/I/B calls issued by the flushes
+        uint64_t m_UploadCalls;
+        uint64_t m_RegistersUploaded;
+        // writes skipped because the registers already held the same values
+        uint64_t m_RedundantWrites;
+    };
+
+    enum D3D9ConstantRegisterSet : uint32_t {
+        // float4 registers (c#), Set*ShaderConstantF
+        CONSTANT_REGISTER_SET_FLOAT4,
+        // int4 registers (i#), Set*ShaderConstantI
+        CONSTANT_REGISTER_SET_INT4,
+        // bool registers (b#), one BOOL each, Set*ShaderConstantB
+        CONSTANT_REGISTER_SET_BOOL
+    };
+
+    // CPU copy of one stage's constant registers of one register set. Writes only touch the copy and mark the
+    // registers dirty; Flush uploads every dirty run of registers with a single Set*ShaderConstantF/I/B call.
+    struct D3D9ConstantRegisterFile {
+        // runs separated by up to this many clean registers are uploaded as one, a few extra bytes are cheaper
+        // than another driver call
+        static constexpr uint32_t MAX_MERGE_GAP = 2;
+
+        D3D9ConstantRegisterFile(
+                core::runtime::graphics::ShaderType stage,
+                uint32_t registerCount,
+                D3D9ConstantRegisterSet registerSet = CONSTANT_REGISTER_SET_FLOAT4
+        );
+
+        // returns false when the registers already held these values; float data only fits a FLOAT4 file,
+        // int data an INT4 (four ints per register) or BOOL (one int per register) file
+        bool Write(uint32_t firstRegister, const float *data, uint32_t registerCount);
+
+        bool Write(uint32_t firstRegister, const int *data, uint32_t registerCount);
+
+        void Flush(IDirect3DDevice9 *device, D3D9ShaderConstantStats &stats);
+
+        // marks every register written so far as dirty, e.g. after a device reset cleared them
+        void Invalidate();
+
+        uint32_t GetRegisterCount() const {
+            return m_RegisterCount;
+        }
+
+        D3D9ConstantRegisterSet GetRegisterSet() const {
+            return m_RegisterSet;
+        }
+
+    protected:
+        bool WriteWords(uint32_t firstRegister, const void *data, uint32_t registerCount);
+
+        void MarkDirty(uint32_t firstRegister, uint32_t registerCount);
+
+        core::runtime::graphics::ShaderType m_Stage;
+        D3D9ConstantRegisterSet m_RegisterSet;
+        uint32_t m_RegisterCount;
+        // 32-bit words per register: 4 for float4/int4, 1 for bool
+        uint32_t m_RegisterWords;
+
+        std::vector<uint32_t> m_Registers;
+        std::vector<uint64_t> m_DirtyMask;
+        std::vector<uint64_t> m_WrittenMask;
+        bool m_HasDirty = false;
+    };
+
+    enum D3D9UniformStage : uint32_t {
+        UNIFORM_STAGE_VERTEX = 1,
+        UNIFORM_STAGE_FRAGMENT = 2,
+        UNIFORM_STAGE_ALL = UNIFORM_STAGE_VERTEX | UNIFORM_STAGE_FRAGMENT
+    };
+
+    // A block of constant registers at a fixed location, shared by every program that declares the same
+    // registers, e.g. "float4x4 g_ViewProjection : register(c0);". Typical blocks are per-frame (camera, time)
+    // and per-material data. Offsets are in registers relative to the start of the block.
+    // Matrices are stored for HLSL's default column_major packing, like D3D9ShaderProgram::SetUniformMat4.
+    struct D3D9UniformBlock {
+        D3D9UniformBlock(uint32_t stages, uint32_t baseRegister, uint32_t registerCount);
+
+        void SetMat4(uint32_t offset, const glm::mat4 &value);
+
+        void SetVec4(uint32_t offset, const glm::vec4 &value);
+
+        void SetFloat4(uint32_t offset, const float *values, uint32_t registerCount = 1);
+
+        void SetFloat(uint32_t offset, float value);
+
+        void SetInt(uint32_t offset, int value);
+
+        uint32_t GetStages() const {
+            return m_Stages;
+        }
+
+        uint32_t GetBaseRegister() const {
+            return m_BaseRegister;
+        }
+
+        uint32_t GetRegisterCount() const {
+            return m_RegisterCount;
+        }
+
+        const float *GetData() const {
+            return m_Data.data();
+        }
+
+        // increases on every change, lets bindings notice the block was modified
+        uint64_t GetVersion() const {
+            return m_Version;
+        }
+
+    protected:
+        bool CheckRange(uint32_t offset, uint32_t registerCount) const;
+
+        uint32_t m_Stages;
+        uint32_t m_BaseRegister;
+        uint32_t m_RegisterCount;
+        std::vector<float> m_Data;
+        uint64_t m_Version = 1;
+    };
+
+    // The shadow register files of both stages plus the uniform blocks bound to them. Programs write their
+    // uniforms here instead of to the device; everything dirty is flushed right before a draw.
+    struct D3D9ShaderConstants {
+        // the ps_3_0 limit is lower than the vs_3_0 one
+        static constexpr uint32_t VERTEX_REGISTER_COUNT = 256;
+        static constexpr uint32_t FRAGMENT_REGISTER_COUNT = 224;
+        // both vs_3_0 and ps_3_0 have 16 int4 and 16 bool registers
+        static constexpr uint32_t INT_REGISTER_COUNT = 16;
+        static constexpr uint32_t BOOL_REGISTER_COUNT = 16;
+
+        D3D9ShaderConstants();
+
+        // the block stays bound until unbound; it must outlive the binding
+        void BindBlock(D3D9UniformBlock *block);
+
+        void UnbindBlock(D3D9UniformBlock *block);
+
+        void Write(core::runtime::graphics::ShaderType stage, uint32_t firstRegister, const float *data, uint32_t registerCount);
+
+        // four ints per register
+        void WriteInt(core::runtime::graphics::ShaderType stage, uint32_t firstRegister, const int *data, uint32_t registerCount);
+
+        // one BOOL (0 or 1) per register
+        void WriteBool(core::runtime::graphics::ShaderType stage, uint32_t firstRegister, const int *data, uint32_t registerCount);
+
+        // commits modified blocks and uploads all dirty registers; called by the draw paths
+        void Flush(IDirect3DDevice9 *device);
+
+        void Invalidate();
+
+        const D3D9ShaderConstantStats &GetStats() const {
+            return m_Stats;
+        }
+
+        void ResetStats() {
+            m_Stats = {};
+        }
+
+    protected:
+        struct BlockBinding {
+            D3D9UniformBlock *m_Block;
+            uint64_t m_CommittedVersion;
+        };
+
+        void CountWrite(bool changed);
+
+        D3D9ConstantRegisterFile m_VertexRegisters;
+        D3D9ConstantRegisterFile m_FragmentRegisters;
+        D3D9ConstantRegisterFile m_VertexIntRegisters;
+        D3D9ConstantRegisterFile m_FragmentIntRegisters;
+        D3D9ConstantRegisterFile m_VertexBoolRegisters;
+        D3D9ConstantRegisterFile m_FragmentBoolRegisters;
+        std::vector<BlockBinding> m_Blocks;
+
+        D3D9ShaderConstantStats m_Stats{};
+    };
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace engine::backend::dx9 {
+    // Shader packs hold precompiled shader bytecode plus its constant table reflection in a single file.
+    // The layout is designed to be used straight from a read-only memory mapping:
+    //
+    //   D3D9ShaderPackHeader
+    //   D3D9ShaderPackEntry[m_EntryCount]    sorted by m_NameHash
+    //   D3D9ShaderPackConstant[...]          referenced by the entries
+    //   string table                         names, not NUL terminated
+    //   bytecode blobs                       4-byte aligned, as expected by Create*Shader
+    //
+    // All offsets are absolute file offsets, all values are little-endian.
+
+    constexpr uint32_t D3D9_SHADER_PACK_MAGIC = 0x4B505352; // "RSPK"
+    constexpr uint32_t D3D9_SHADER_PACK_VERSION = 1;
+
+    enum D3D9ShaderPackStage : uint32_t {
+        SHADER_PACK_STAGE_VERTEX = 1,
+        SHADER_PACK_STAGE_FRAGMENT = 2
+    };
+
+    struct D3D9ShaderPackHeader {
+        uint32_t m_Magic;
+        uint32_t m_Version;
+        uint32_t m_EntryCount;
+        uint32_t m_ConstantCount;
+        uint32_t m_StringTableOffset;
+        uint32_t m_StringTableSize;
+    };
+
+    struct D3D9ShaderPackEntry {
+        uint64_t m_NameHash;
+        uint32_t m_NameOffset;
+        uint32_t m_NameLength;
+        uint32_t m_Stage;
+        uint32_t m_BytecodeOffset;
+        uint32_t m_BytecodeSize;
+        uint32_t m_FirstConstant;
+        uint32_t m_ConstantCount;
+        uint32_t m_Reserved;
+    };
+
+    // mirrors the parts of D3DXCONSTANT_DESC needed to set constants without a D3DX constant table
+    struct D3D9ShaderPackConstant {
+        uint32_t m_NameOffset;
+        uint32_t m_NameLength;
+        uint16_t m_RegisterSet;
+        uint16_t m_RegisterIndex;
+        uint16_t m_RegisterCount;
+        uint16_t m_Class;
+    };
+
+    static_assert(sizeof(D3D9ShaderPackHeader) == 24);
+    static_assert(sizeof(D3D9ShaderPackEntry) == 40);
+    static_assert(sizeof(D3D9ShaderPackConstant) == 16);
+
+    // FNV-1a; used as the lookup key of pack entries
+    uint64_t D3D9_HashShaderName(std::string_view name);
+
+    // Read-only view of a shader pack, either memory-mapped from disk or pointing at caller-owned memory.
+    struct D3D9ShaderPack {
+        D3D9ShaderPack() = default;
+
+        D3D9ShaderPack(const D3D9ShaderPack &) = delete;
+
+        D3D9ShaderPack &operator=(const D3D9ShaderPack &) = delete;
+
+        ~D3D9ShaderPack() {
+            Close();
+        }
+
+        bool Open(const std::string &path);
+
+        // the memory must outlive the pack
+        bool OpenFromMemory(std::span<const unsigned char> data);
+
+        void Close();
+
+        bool IsOpen() const {
+            return m_Header != nullptr;
+        }
+
+        const D3D9ShaderPackEntry *Find(std::string_view name) const;
+
+        std::span<const D3D9ShaderPackEntry> GetEntries() const;
+
+        std::span<const unsigned char> GetBytecode(const D3D9ShaderPackEntry &entry) const;
+
+        std::span<const D3D9ShaderPackConstant> GetConstants(const D3D9ShaderPackEntry &entry) const;
+
+        std::string_view GetString(uint32_t offset, uint32_t length) const;
+
+        // the whole string table; name offsets of entries and constants are relative to its start
+        std::string_view GetStringTable() const;
+
+        std::string_view GetName(const D3D9ShaderPackEntry &entry) const {
+            return GetString(entry.m_NameOffset, entry.m_NameLength);
+        }
+
+    protected:
+        bool Validate();
+
+        std::span<const unsigned char> m_Data;
+        const D3D9ShaderPackHeader *m_Header = nullptr;
+
+        // platform mapping handles, only set when the pack was opened from a file
+        void *m_MappedView = nullptr;
+        size_t m_MappedSize = 0;
+        intptr_t m_FileHandle = -1;
+        intptr_t m_MappingHandle = -1;
+    };
+
+    struct D3D9ShaderPackWriter {
+        struct Constant {
+            std::string m_Name;
+            uint16_t m_RegisterSet;
+            uint16_t m_RegisterIndex;
+            uint16_t m_RegisterCount;
+            uint16_t m_Class;
+        };
+
+        void AddShader(std::string_view name, D3D9ShaderPackStage stage, std::span<const unsigned char> bytecode, std::vector<Constant> constants);
+
+        std::vector<unsigned char> Serialize() const;
+
+        bool Write(const std::string &path) const;
+
+    protected:
+        struct Shader {
+            std::string m_Name;
+            D3D9ShaderPackStage m_Stage;
+            std::vector<unsigned char> m_Bytecode;
+            std::vector<Constant> m_Constants;
+        };
+
+        std::vector<Shader> m_Shaders;
+    };
+}
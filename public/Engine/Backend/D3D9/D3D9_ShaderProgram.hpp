@@ -2,13 +2,23 @@
 
 #include <Engine/Core/Runtime/Graphics/IShaderProgram.hpp>
 #include <Engine/Core/Runtime/Graphics/IShader.hpp>
+#include <Engine/Backend/D3D9/D3D9_ShaderConstants.hpp>
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
 // forward definition of D3D9 types
 struct IDirect3DDevice9;
 
 namespace engine::backend::dx9 {
     struct D3D9ShaderProgram : public core::runtime::graphics::IShaderProgram {
-        D3D9ShaderProgram(IDirect3DDevice9 *device) : m_Device(device) {}
+        // with shader constants, uniforms go to the shadow float4/int4/bool registers and reach the device on the
+        // next draw (and again after a reset); without them they are set on the device right away
+        D3D9ShaderProgram(IDirect3DDevice9 *device, D3D9ShaderConstants *shaderConstants = nullptr) :
+                m_Device(device),
+                m_ShaderConstants(shaderConstants) {}
 
         bool Link() override;
 
@@ -29,7 +39,39 @@ namespace engine::backend::dx9 {
         bool IsLinked() override;
 
     protected:
+        // where a uniform lives in the registers of one stage
+        struct UniformLocation {
+            bool m_IsValid = false;
+            bool m_IsRowMajor = false;
+            uint32_t m_RegisterSet = 0;
+            uint32_t m_Register = 0;
+            uint32_t m_RegisterCount = 0;
+        };
+
+        struct UniformLocations {
+            UniformLocation m_Vertex;
+            UniformLocation m_Fragment;
+        };
+
+        // lets the cache be searched with a string_view, so setting a uniform never allocates a key
+        struct UniformNameHash {
+            using is_transparent = void;
+
+            size_t operator()(std::string_view name) const {
+                return std::hash<std::string_view>{}(name);
+            }
+        };
+
+        const UniformLocations &GetUniformLocations(std::string_view name);
+
+        void WriteUniform(core::runtime::graphics::ShaderType stage, const UniformLocation &location, const float *data, uint32_t registerCount);
+
+        void WriteUniform(core::runtime::graphics::ShaderType stage, const UniformLocation &location, int value);
+
         IDirect3DDevice9 *m_Device;
+        D3D9ShaderConstants *m_ShaderConstants;
+        // constant lookups are string compares, so resolved locations are cached per name
+        std::unordered_map<std::string, UniformLocations, UniformNameHash, std::equal_to<>> m_UniformLocations;
         std::unique_ptr<core::runtime::graphics::IShader> m_FragmentShader;
         std::unique_ptr<core::runtime::graphics::IShader> m_VertexShader;
     };
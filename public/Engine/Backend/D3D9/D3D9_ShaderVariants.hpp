@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Engine/Core/Runtime/Graphics/IShader.hpp>
+#include <Engine/Backend/D3D9/D3D9_Shader.hpp>
+
+// forward definition of D3D9 types
+struct IDirect3DDevice9;
+
+namespace engine::backend::dx9 {
+    // one bit per keyword, in the order the keywords were given to the variant set
+    using D3D9ShaderKeywordMask = uint64_t;
+
+    struct D3D9ShaderVariantStats {
+        uint64_t m_Hits;
+        uint64_t m_Misses;
+        uint64_t m_Compiles;
+        uint64_t m_Failures;
+        double m_CompileTimeMs;
+        size_t m_VariantCount;
+        size_t m_BytecodeBytes;
+    };
+
+    // Joins the background compile workers shared by all variant sets. D3D9Backend::Shutdown calls it; modules that
+    // can be unloaded must get here before that, the workers can't be joined safely during static destruction.
+    // Compiles that were queued but not started stay queued and restart the workers on the next Prewarm.
+    void D3D9_ShutdownShaderCompileWorkers();
+
+    // A single shader source compiled into variants on demand. Every keyword enabled in a mask is passed to the
+    // compiler as "#define <KEYWORD> 1", so features like fog or skinning become #ifdef blocks in one source.
+    // Each variant's device shader is created, and its constant table parsed, once; CreateVariant then hands out
+    // shaders that share it.
+    struct D3D9ShaderVariantSet {
+        static constexpr size_t MAX_KEYWORDS = 64;
+
+        D3D9ShaderVariantSet(IDirect3DDevice9 *device,
+                             std::string source,
+                             core::runtime::graphics::ShaderType type,
+                             std::vector<std::string> keywords);
+
+        D3D9ShaderVariantSet(const D3D9ShaderVariantSet &) = delete;
+
+        D3D9ShaderVariantSet &operator=(const D3D9ShaderVariantSet &) = delete;
+
+        ~D3D9ShaderVariantSet();
+
+        D3D9ShaderKeywordMask GetKeywordMask(std::string_view keyword) const;
+
+        // compiles the variant if it's not cached yet, or waits for a background compile in flight;
+        // the returned shader shares the variant's device shader, so cache hits don't touch the device
+        std::unique_ptr<core::runtime::graphics::IShader> CreateVariant(D3D9ShaderKeywordMask mask);
+
+        // queues the given variants on the shared compile workers; only the compiler runs there, never the device
+        void Prewarm(std::span<const D3D9ShaderKeywordMask> masks);
+
+        D3D9ShaderVariantStats GetStats() const;
+
+    protected:
+        struct CompileResult {
+            bool m_Success;
+            std::vector<unsigned char> m_Bytecode;
+            std::string m_Log;
+            double m_CompileTimeMs;
+        };
+
+        struct Variant {
+            std::shared_future<CompileResult> m_Result;
+            bool m_Accounted = false;
+            // created from the bytecode on first use
+            std::unique_ptr<D3D9Shader> m_Shader;
+        };
+
+        CompileResult CompileVariant(D3D9ShaderKeywordMask mask) const;
+
+        const CompileResult &ResolveVariant(Variant &variant);
+
+        IDirect3DDevice9 *m_Device;
+        std::string m_Source;
+        core::runtime::graphics::ShaderType m_Type;
+        std::vector<std::string> m_Keywords;
+
+        std::unordered_map<D3D9ShaderKeywordMask, Variant> m_Variants;
+
+        uint64_t m_Hits = 0;
+        uint64_t m_Misses = 0;
+        uint64_t m_Compiles = 0;
+        uint64_t m_Failures = 0;
+        double m_CompileTimeMs = 0.0;
+    };
+}
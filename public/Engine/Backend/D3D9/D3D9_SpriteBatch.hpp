@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <Engine/Core/Runtime/Graphics/IShaderProgram.hpp>
+#include <Engine/Core/Runtime/Graphics/ITexture.hpp>
+#include <Engine/Backend/D3D9/D3D9_ResourceRegistry.hpp>
+#include <Engine/Backend/D3D9/D3D9_ShaderConstants.hpp>
+
+// forward definition of D3D9 types
+struct IDirect3DDevice9;
+struct IDirect3DVertexBuffer9;
+struct IDirect3DIndexBuffer9;
+
+namespace engine::backend::dx9 {
+    struct D3D9SpriteBatchStats {
+        uint64_t m_Quads;
+        uint64_t m_DrawCalls;
+        double m_CpuTimeMs;
+    };
+
+    // Batches 2D quads into a streaming vertex buffer. Consecutive quads sharing program, texture and scissor
+    // rectangle end up in a single indexed draw; changing any of them flushes the quads queued so far.
+    // Quads use the regular engine vertex layout, so UI shaders don't need a separate input signature.
+    struct D3D9SpriteBatch : public D3D9DeviceResource {
+        // 16-bit indices limit a single batch to 16384 quads
+        static constexpr size_t MAX_QUADS = 16384;
+
+        D3D9SpriteBatch(
+                IDirect3DDevice9 *device,
+                D3D9ResourceRegistry *resourceRegistry = nullptr,
+                size_t maxQuads = 4096,
+                D3D9ShaderConstants *shaderConstants = nullptr
+        );
+
+        ~D3D9SpriteBatch();
+
+        bool Create();
+
+        void Destroy();
+
+        void SetProgram(core::runtime::graphics::IShaderProgram *program);
+
+        void SetTexture(core::runtime::graphics::ITexture *texture);
+
+        // only the rectangle is part of the batch state; the scissor test itself is a backend feature
+        void SetScissor(core::math::Vector2 start, core::math::Vector2 size);
+
+        void DrawQuad(
+                core::math::Vector2 position,
+                core::math::Vector2 size,
+                core::math::Vector2 uvMin,
+                core::math::Vector2 uvMax,
+                core::runtime::graphics::Color color,
+                float depth = 0.0f
+        );
+
+        void Flush();
+
+        // resets the per-frame counters; the previous frame stays available through GetLastFrameStats
+        void BeginFrame();
+
+        const D3D9SpriteBatchStats &GetFrameStats() const {
+            return m_FrameStats;
+        }
+
+        const D3D9SpriteBatchStats &GetLastFrameStats() const {
+            return m_LastFrameStats;
+        }
+
+        void OnDeviceLost() override;
+
+        bool OnDeviceReset() override;
+
+        void OnRegistryDestroyed() override {
+            m_ResourceRegistry = nullptr;
+        }
+
+    protected:
+        // raw layout of core::runtime::graphics::Vertex, see the vertex declaration
+        struct SpriteVertex {
+            float m_Position[3];
+            float m_UV[2];
+            float m_Normal[3];
+            uint32_t m_Color;
+        };
+
+        static_assert(sizeof(SpriteVertex) == 36);
+
+        struct ScissorRect {
+            long m_Left, m_Top, m_Right, m_Bottom;
+
+            bool operator==(const ScissorRect &other) const = default;
+        };
+
+        bool CreateDeviceBuffers();
+
+        void ReleaseDeviceBuffers();
+
+        IDirect3DDevice9 *m_Device;
+        D3D9ResourceRegistry *m_ResourceRegistry;
+        D3D9ShaderConstants *m_ShaderConstants;
+        IDirect3DVertexBuffer9 *m_VertexBuffer = nullptr;
+        IDirect3DIndexBuffer9 *m_IndexBuffer = nullptr;
+
+        size_t m_MaxQuads;
+
+        // quads generated on the CPU and not submitted yet
+        std::vector<SpriteVertex> m_Staging;
+        size_t m_QueuedQuads = 0;
+
+        // position of the next write in the streaming vertex buffer, in quads
+        size_t m_BufferCursor = 0;
+
+        core::runtime::graphics::IShaderProgram *m_Program = nullptr;
+        core::runtime::graphics::ITexture *m_Texture = nullptr;
+        ScissorRect m_Scissor{};
+        bool m_HasScissor = false;
+
+        D3D9SpriteBatchStats m_FrameStats{};
+        D3D9SpriteBatchStats m_LastFrameStats{};
+    };
+}
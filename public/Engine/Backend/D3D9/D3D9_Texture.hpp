@@ -1,17 +1,44 @@
 #pragma once
 
 #include <Engine/Core/Runtime/Graphics/ITexture.hpp>
+#include <Engine/Backend/D3D9/D3D9_ResourceRegistry.hpp>
+
+#include <vector>
 
 // forward definition of D3D9 types
 struct IDirect3DDevice9;
 struct IDirect3DTexture9;
+struct IDirect3DSurface9;
 
 namespace engine::backend::dx9 {
-    struct D3D9Texture : public core::runtime::graphics::ITexture {
-        D3D9Texture(IDirect3DDevice9* device) : m_Device(device), m_Texture(nullptr) {}
+    struct D3D9RenderTargetPool;
+    struct D3D9TextureBudget;
+
+    enum class D3D9TextureFormat {
+        TEXTURE_FORMAT_RGBA8,
+        TEXTURE_FORMAT_RGBA16F,
+        TEXTURE_FORMAT_R32F,
+        TEXTURE_FORMAT_D24S8
+    };
+
+    struct D3D9Texture : public core::runtime::graphics::ITexture, public D3D9DeviceResource {
+        D3D9Texture(IDirect3DDevice9* device,
+                    D3D9RenderTargetPool* renderTargetPool = nullptr,
+                    D3D9TextureBudget* textureBudget = nullptr,
+                    D3D9ResourceRegistry* resourceRegistry = nullptr) :
+                m_Device(device),
+                m_Texture(nullptr),
+                m_RenderTargetPool(renderTargetPool),
+                m_TextureBudget(textureBudget),
+                m_ResourceRegistry(resourceRegistry) {}
+
+        ~D3D9Texture();
 
         bool Create(const core::runtime::graphics::Bitmap& bitmap) override;
 
+        // creates a texture that can be rendered into; depth formats create a depth-stencil surface instead
+        bool CreateRenderTarget(uint32_t width, uint32_t height, D3D9TextureFormat format);
+
         void Destroy() override;
 
         core::runtime::graphics::Bitmap Download() override;
@@ -22,12 +49,87 @@ namespace engine::backend::dx9 {
 
         void Unbind() override;
 
+        // releases the video memory while keeping the CPU-side copy; only possible for budgeted textures
+        bool Evict();
+
+        // re-creates an evicted texture from its CPU-side copy
+        bool Restore();
+
+        void OnDeviceLost() override;
+
+        bool OnDeviceReset() override;
+
+        void OnRegistryDestroyed() override {
+            m_ResourceRegistry = nullptr;
+        }
+
+        // the budget is being destroyed before this texture; the texture stays resident from then on
+        void OnBudgetDestroyed() {
+            m_TextureBudget = nullptr;
+        }
+
+        bool CanEvict() const {
+            return m_TextureBudget != nullptr && m_Texture != nullptr && !m_SourcePixels.empty();
+        }
+
+        bool IsResident() const {
+            return m_Texture != nullptr || m_Surface != nullptr;
+        }
+
+        uint64_t GetLastUsedFrame() const {
+            return m_LastUsedFrame;
+        }
+
         IDirect3DTexture9* GetHandle() const {
             return m_Texture;
         }
 
+        // level 0 of a color render target, or the depth-stencil surface
+        IDirect3DSurface9* GetSurface() const {
+            return m_Surface;
+        }
+
+        D3D9TextureFormat GetFormat() const {
+            return m_Format;
+        }
+
+        bool IsRenderTarget() const {
+            return m_IsRenderTarget;
+        }
+
+        bool IsDepthStencil() const {
+            return m_Format == D3D9TextureFormat::TEXTURE_FORMAT_D24S8;
+        }
+
+        size_t GetByteSize() const {
+            return m_ByteSize;
+        }
+
     protected:
+        // restores an evicted texture and tells the budget about it; every use of an evicted texture goes through here
+        bool MakeResident();
+
         IDirect3DDevice9* m_Device;
         IDirect3DTexture9* m_Texture;
+        IDirect3DSurface9* m_Surface = nullptr;
+        D3D9RenderTargetPool* m_RenderTargetPool;
+        D3D9TextureBudget* m_TextureBudget;
+        D3D9ResourceRegistry* m_ResourceRegistry;
+
+        // A8R8G8B8 copy of the pixels, kept only by textures the budget may evict
+        std::vector<uint32_t> m_SourcePixels;
+        uint32_t m_Width = 0;
+        uint32_t m_Height = 0;
+        uint64_t m_LastUsedFrame = 0;
+
+        // whether video memory has to be re-created once the device is reset
+        bool m_RestoreOnReset = false;
+
+        // non-evictable textures live in D3DPOOL_MANAGED, the runtime keeps their copy and restores them itself
+        bool m_IsManaged = false;
+
+        D3D9TextureFormat m_Format = D3D9TextureFormat::TEXTURE_FORMAT_RGBA8;
+        bool m_IsRenderTarget = false;
+        size_t m_ByteSize = 0;
     };
 }
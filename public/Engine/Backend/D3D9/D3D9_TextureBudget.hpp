@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// forward definition of D3D9 types
+struct IDirect3DDevice9;
+
+namespace engine::backend::dx9 {
+    struct D3D9Texture;
+
+    struct D3D9TextureBudgetStats {
+        size_t m_BudgetBytes;
+        size_t m_ResidentBytes;
+        size_t m_EvictedBytes;
+        size_t m_ResidentCount;
+        size_t m_EvictedCount;
+        uint64_t m_EvictionCount;
+        uint64_t m_RestoreCount;
+    };
+
+    // Accounts the video memory used by every texture created through the backend and keeps it under a budget.
+    // When the budget is exceeded, or the driver reports little free texture memory, the least recently bound
+    // textures are evicted; they are re-created from their CPU-side copy the next time they are bound.
+    // D3D9Backend::BeginFrame calls BeginFrame(); a budget used without it must be advanced by its owner, otherwise
+    // the LRU clock stands still and no texture is ever evicted.
+    struct D3D9TextureBudget {
+        explicit D3D9TextureBudget(IDirect3DDevice9 *device) : m_Device(device) {}
+
+        D3D9TextureBudget(const D3D9TextureBudget &) = delete;
+
+        D3D9TextureBudget &operator=(const D3D9TextureBudget &) = delete;
+
+        // detaches every registered texture, textures may outlive the backend
+        ~D3D9TextureBudget();
+
+        void Register(D3D9Texture *texture);
+
+        void Unregister(D3D9Texture *texture);
+
+        // called by textures whenever their video memory is allocated or released
+        void OnTextureResident(D3D9Texture *texture);
+
+        void OnTextureReleased(D3D9Texture *texture);
+
+        void OnTextureRestored(D3D9Texture *) {
+            m_RestoreCount++;
+        }
+
+        // advances the LRU clock and enforces the budget
+        void BeginFrame();
+
+        // makes room for an allocation of the given size; never evicts `requester` or textures bound this frame
+        bool Reserve(size_t bytes, const D3D9Texture *requester);
+
+        // evicts least recently used textures until at least `bytes` were freed
+        size_t Evict(size_t bytes, const D3D9Texture *requester);
+
+        // 0 disables the fixed budget; only the low memory check stays active.
+        // Only textures created while the budget is enabled can be evicted, the others go to the managed pool.
+        void SetBudget(size_t bytes) {
+            m_BudgetBytes = bytes;
+        }
+
+        // evict when GetAvailableTextureMem drops under this value; 0 disables the check
+        void SetLowMemoryThreshold(size_t bytes) {
+            m_LowMemoryThreshold = bytes;
+        }
+
+        size_t GetBudget() const {
+            return m_BudgetBytes;
+        }
+
+        // whether any eviction can happen at all
+        bool IsEnabled() const {
+            return m_BudgetBytes > 0 || m_LowMemoryThreshold > 0;
+        }
+
+        uint64_t GetFrameIndex() const {
+            return m_FrameIndex;
+        }
+
+        bool IsResident(const D3D9Texture *texture) const;
+
+        D3D9TextureBudgetStats GetStats() const;
+
+    protected:
+        IDirect3DDevice9 *m_Device;
+
+        std::vector<D3D9Texture *> m_Textures;
+
+        uint64_t m_FrameIndex = 1;
+        size_t m_BudgetBytes = 0;
+        size_t m_LowMemoryThreshold = 0;
+        size_t m_ResidentBytes = 0;
+
+        uint64_t m_EvictionCount = 0;
+        uint64_t m_RestoreCount = 0;
+    };
+}
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <Engine/Backend/D3D9/D3D9_Frame.hpp>
+
+namespace engine::backend::dx9 {
+    // API traces record every backend and resource call as a flat stream of records:
+    //
+    //   D3D9TraceHeader
+    //   { D3D9TraceRecord, payload[m_PayloadSize] }...
+    //
+    // Resource payloads (vertex data, pixels, shader source and bytecode) are not stored inline. The first time
+    // some content appears it's written once as a TRACE_OP_BLOB record keyed by its content hash; calls only
+    // reference the hash, so re-uploading the same data every frame costs a few bytes per call.
+    // Objects are identified by ids assigned in creation order, the backend itself is object 0.
+    // All values are little-endian.
+
+    constexpr uint32_t D3D9_TRACE_MAGIC = 0x52544452; // "RDTR"
+    // version 2 added the D3D9 frame ops; version 1 traces are still read, they just never contain them
+    constexpr uint32_t D3D9_TRACE_VERSION = 2;
+    constexpr uint32_t D3D9_TRACE_MIN_VERSION = 1;
+
+    enum D3D9TraceOp : uint8_t {
+        TRACE_OP_BLOB = 0,
+        TRACE_OP_RELEASE,
+
+        TRACE_OP_BACKEND_INITIALIZE,
+        TRACE_OP_BACKEND_SHUTDOWN,
+        TRACE_OP_BACKEND_SET_VIEWPORT,
+        TRACE_OP_BACKEND_SET_SCISSOR,
+        TRACE_OP_BACKEND_ENABLE_FEATURES,
+        TRACE_OP_BACKEND_DISABLE_FEATURES,
+        TRACE_OP_BACKEND_CLEAR,
+        TRACE_OP_BACKEND_CREATE_VERTEX_BUFFER,
+        TRACE_OP_BACKEND_CREATE_SHADER,
+        TRACE_OP_BACKEND_CREATE_SHADER_PROGRAM,
+        TRACE_OP_BACKEND_CREATE_TEXTURE,
+
+        TRACE_OP_VERTEX_BUFFER_CREATE,
+        TRACE_OP_VERTEX_BUFFER_DESTROY,
+        TRACE_OP_VERTEX_BUFFER_BIND,
+        TRACE_OP_VERTEX_BUFFER_UNBIND,
+        TRACE_OP_VERTEX_BUFFER_DRAW,
+        TRACE_OP_VERTEX_BUFFER_UPLOAD,
+
+        TRACE_OP_SHADER_COMPILE,
+        TRACE_OP_SHADER_DESTROY,
+        TRACE_OP_SHADER_SET_SOURCE,
+        TRACE_OP_SHADER_USE_COMPILED,
+
+        TRACE_OP_PROGRAM_LINK,
+        TRACE_OP_PROGRAM_DESTROY,
+        TRACE_OP_PROGRAM_BIND,
+        TRACE_OP_PROGRAM_UNBIND,
+        TRACE_OP_PROGRAM_ADD_SHADER,
+        TRACE_OP_PROGRAM_SET_UNIFORM_MAT4,
+        TRACE_OP_PROGRAM_SET_UNIFORM_I,
+
+        TRACE_OP_TEXTURE_CREATE,
+        TRACE_OP_TEXTURE_DESTROY,
+        TRACE_OP_TEXTURE_BIND,
+        TRACE_OP_TEXTURE_UNBIND,
+
+        // frame boundary set by the application, used to report per-frame timings
+        TRACE_OP_FRAME,
+
+        // D3D9FrameBackend calls, recorded by D3D9FrameTraceBackend; the payload of all but EndFrame is a clear
+        // descriptor: flags, color, depth, stencil, rect count, rects
+        TRACE_OP_BACKEND_BEGIN_FRAME,
+        TRACE_OP_BACKEND_END_FRAME,
+        TRACE_OP_BACKEND_CLEAR_DESC,
+
+        TRACE_OP_COUNT
+    };
+
+    const char *D3D9_GetTraceOpName(D3D9TraceOp op);
+
+    struct D3D9TraceHeader {
+        uint32_t m_Magic;
+        uint32_t m_Version;
+    };
+
+    struct D3D9TraceRecord {
+        uint8_t m_Op;
+        uint8_t m_Reserved[3];
+        uint32_t m_Object;
+        uint32_t m_PayloadSize;
+    };
+
+    static_assert(sizeof(D3D9TraceHeader) == 8);
+    static_assert(sizeof(D3D9TraceRecord) == 12);
+
+    // FNV-1a over the content, combined with the size when used as a blob key
+    uint64_t D3D9_HashTraceBlob(std::span<const unsigned char> data);
+
+    struct D3D9TraceBlobKey {
+        uint64_t m_Hash;
+        uint64_t m_Size;
+
+        bool operator==(const D3D9TraceBlobKey &other) const = default;
+    };
+
+    struct D3D9TraceBlobKeyHash {
+        size_t operator()(const D3D9TraceBlobKey &key) const {
+            return static_cast<size_t>(key.m_Hash ^ (key.m_Size * 0x9e3779b97f4a7c15ull));
+        }
+    };
+
+    // appends plain values to a record payload
+    struct D3D9TracePayload {
+        template<typename T>
+        void Write(const T &value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+
+            auto bytes = reinterpret_cast<const unsigned char *>(&value);
+            m_Data.insert(m_Data.end(), bytes, bytes + sizeof(T));
+        }
+
+        void WriteString(std::string_view value) {
+            Write(static_cast<uint32_t>(value.size()));
+            m_Data.insert(m_Data.end(), value.begin(), value.end());
+        }
+
+        void WriteBlobKey(const D3D9TraceBlobKey &key) {
+            Write(key.m_Hash);
+            Write(key.m_Size);
+        }
+
+        std::vector<unsigned char> m_Data;
+    };
+
+    // reads values back in the order they were written; reading past the end yields zeroes and sets m_Overflow
+    struct D3D9TracePayloadReader {
+        explicit D3D9TracePayloadReader(std::span<const unsigned char> data) : m_Data(data) {}
+
+        template<typename T>
+        T Read() {
+            static_assert(std::is_trivially_copyable_v<T>);
+
+            T value{};
+            if (m_Offset + sizeof(T) > m_Data.size()) {
+                m_Overflow = true;
+                return value;
+            }
+
+            memcpy(&value, m_Data.data() + m_Offset, sizeof(T));
+            m_Offset += sizeof(T);
+            return value;
+        }
+
+        std::string_view ReadString() {
+            auto length = Read<uint32_t>();
+            if (m_Offset + length > m_Data.size()) {
+                m_Overflow = true;
+                return {};
+            }
+
+            std::string_view value(reinterpret_cast<const char *>(m_Data.data() + m_Offset), length);
+            m_Offset += length;
+            return value;
+        }
+
+        D3D9TraceBlobKey ReadBlobKey() {
+            D3D9TraceBlobKey key{};
+            key.m_Hash = Read<uint64_t>();
+            key.m_Size = Read<uint64_t>();
+            return key;
+        }
+
+        std::span<const unsigned char> m_Data;
+        size_t m_Offset = 0;
+        bool m_Overflow = false;
+    };
+
+    void D3D9_WriteTraceClearDesc(D3D9TracePayload &payload, const D3D9ClearDesc &desc);
+
+    // returns false for a truncated descriptor
+    bool D3D9_ReadTraceClearDesc(D3D9TracePayloadReader &payload, D3D9ClearDesc &desc);
+
+    struct D3D9TraceWriterStats {
+        uint64_t m_Calls;
+        uint64_t m_Blobs;
+        // blob references that were satisfied by an earlier blob with the same content
+        uint64_t m_DeduplicatedBlobs;
+        uint64_t m_DeduplicatedBytes;
+        uint64_t m_BytesWritten;
+    };
+
+    struct D3D9TraceWriter {
+        D3D9TraceWriter() = default;
+
+        D3D9TraceWriter(const D3D9TraceWriter &) = delete;
+
+        D3D9TraceWriter &operator=(const D3D9TraceWriter &) = delete;
+
+        ~D3D9TraceWriter() {
+            Close();
+        }
+
+        bool Open(const std::string &path);
+
+        void Close();
+
+        bool IsOpen() const {
+            return m_File.is_open();
+        }
+
+        uint32_t AllocateObjectId() {
+            return m_NextObjectId++;
+        }
+
+        void WriteCall(D3D9TraceOp op, uint32_t object, const D3D9TracePayload &payload = {});
+
+        // writes the content once and returns the key calls use to reference it
+        D3D9TraceBlobKey WriteBlob(std::span<const unsigned char> data);
+
+        const D3D9TraceWriterStats &GetStats() const {
+            return m_Stats;
+        }
+
+    protected:
+        void WriteRecord(D3D9TraceOp op, uint32_t object, std::span<const unsigned char> payload);
+
+        std::ofstream m_File;
+        uint32_t m_NextObjectId = 1;
+
+        std::unordered_set<D3D9TraceBlobKey, D3D9TraceBlobKeyHash> m_WrittenBlobs;
+        D3D9TraceWriterStats m_Stats{};
+    };
+
+    struct D3D9TraceCall {
+        D3D9TraceOp m_Op;
+        uint32_t m_Object;
+        std::span<const unsigned char> m_Payload;
+    };
+
+    // Loads a whole trace into memory. Blob records are resolved while loading, so calls can look up any blob
+    // they reference; Calls() excludes them.
+    struct D3D9TraceReader {
+        D3D9TraceReader() = default;
+
+        // calls point into the loaded data
+        D3D9TraceReader(const D3D9TraceReader &) = delete;
+
+        D3D9TraceReader &operator=(const D3D9TraceReader &) = delete;
+
+        bool Open(const std::string &path);
+
+        bool OpenFromMemory(std::vector<unsigned char> data);
+
+        const std::vector<D3D9TraceCall> &Calls() const {
+            return m_Calls;
+        }
+
+        std::span<const unsigned char> FindBlob(const D3D9TraceBlobKey &key) const;
+
+        size_t GetBlobCount() const {
+            return m_Blobs.size();
+        }
+
+    protected:
+        bool Parse();
+
+        std::vector<unsigned char> m_Data;
+        std::vector<D3D9TraceCall> m_Calls;
+        std::unordered_map<D3D9TraceBlobKey, std::span<const unsigned char>, D3D9TraceBlobKeyHash> m_Blobs;
+    };
+}
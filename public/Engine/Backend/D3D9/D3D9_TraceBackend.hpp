@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Engine/Core/Runtime/Graphics/IGraphicsBackend.hpp>
+#include <Engine/Backend/D3D9/D3D9_Trace.hpp>
+
+namespace engine::backend::dx9 {
+    // Graphics backend decorator that records every call into a trace before forwarding it to the real backend.
+    // Resources created through it are wrapped as well, so their calls end up in the same trace.
+    // Queries (Size, Download, GetSource, ...) are forwarded but not recorded, they don't change any state.
+    // The wrapped backend and the writer must outlive the tracing backend and every resource it created.
+    struct D3D9TraceBackend : public core::runtime::graphics::IGraphicsBackend {
+        D3D9TraceBackend(core::runtime::graphics::IGraphicsBackend *backend, D3D9TraceWriter *writer) :
+                m_Backend(backend),
+                m_Writer(writer) {}
+
+        bool Initialize() override;
+
+        void Shutdown() override;
+
+        std::string GetName() const override;
+
+        std::string GetIdentifier() const override;
+
+        void SetViewport(core::math::Vector2 pos, core::math::Vector2 size) override;
+
+        void SetScissor(core::math::Vector2 start, core::math::Vector2 size) override;
+
+        void EnableFeatures(core::runtime::graphics::BackendFeature featuresMask) override;
+
+        void DisableFeatures(core::runtime::graphics::BackendFeature featuresMask) override;
+
+        core::runtime::graphics::BackendFeature GetActiveFeatures() override;
+
+        void Clear(core::runtime::graphics::Color color) override;
+
+        std::unique_ptr<core::runtime::graphics::IVertexBuffer> CreateVertexBuffer() override;
+
+        std::unique_ptr<core::runtime::graphics::IShader> CreateShader() override;
+
+        std::unique_ptr<core::runtime::graphics::IShaderProgram> CreateShaderProgram() override;
+
+        std::unique_ptr<core::runtime::graphics::ITexture> CreateTexture() override;
+
+        // marks the end of a frame, so replays can report per-frame timings
+        void MarkFrame();
+
+    protected:
+        core::runtime::graphics::IGraphicsBackend *m_Backend;
+        D3D9TraceWriter *m_Writer;
+    };
+
+    // D3D9TraceBackend that also records the D3D9 frame API (BeginFrame, EndFrame and descriptor clears), so
+    // traces of applications using it replay with the same frames and clears. Both pointers usually refer to
+    // the same backend, e.g. a D3D9Backend or D3D9NullBackend.
+    struct D3D9FrameTraceBackend : public D3D9TraceBackend, public D3D9FrameBackend {
+        D3D9FrameTraceBackend(
+                core::runtime::graphics::IGraphicsBackend *backend,
+                D3D9FrameBackend *frameBackend,
+                D3D9TraceWriter *writer
+        ) :
+                D3D9TraceBackend(backend, writer),
+                m_FrameBackend(frameBackend) {}
+
+        using D3D9TraceBackend::Clear;
+
+        bool Clear(const D3D9ClearDesc &desc) override;
+
+        void BeginFrame(const D3D9ClearDesc &clear = {}) override;
+
+        void EndFrame() override;
+
+    protected:
+        D3D9FrameBackend *m_FrameBackend;
+    };
+}
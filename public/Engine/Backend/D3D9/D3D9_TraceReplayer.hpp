@@ -0,0 +1,64 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <Engine/Core/Runtime/Graphics/IGraphicsBackend.hpp>
+#include <Engine/Backend/D3D9/D3D9_Trace.hpp>
+
+namespace engine::backend::dx9 {
+    struct D3D9TraceOpTiming {
+        uint64_t m_Count;
+        double m_TotalMs;
+        double m_MaxMs;
+    };
+
+    struct D3D9TraceReplayStats {
+        D3D9TraceOpTiming m_Ops[TRACE_OP_COUNT];
+
+        // CPU time of every call, in the order of D3D9TraceReader::Calls
+        std::vector<float> m_CallTimesMs;
+
+        // time between frame markers, including the frame callback
+        std::vector<double> m_FrameTimesMs;
+
+        double m_TotalMs;
+
+        // calls that referenced unknown objects or blobs, or had malformed payloads
+        uint64_t m_Errors;
+    };
+
+    // Re-issues a recorded trace against a backend and measures how long every call takes.
+    // Initialize and Shutdown records are skipped, the owner of the backend decides about its lifetime. Objects
+    // created by the trace are destroyed at the end of every replay, so replays can be repeated on one backend.
+    // Frame API records (BeginFrame, EndFrame, descriptor clears) need a frame backend, usually the same object as
+    // the backend; without one they count as errors.
+    struct D3D9TraceReplayer {
+        explicit D3D9TraceReplayer(core::runtime::graphics::IGraphicsBackend *backend, D3D9FrameBackend *frameBackend = nullptr) :
+                m_Backend(backend),
+                m_FrameBackend(frameBackend) {}
+
+        // called at every frame marker, e.g. to present the back buffer
+        void SetFrameCallback(std::function<void()> callback) {
+            m_FrameCallback = std::move(callback);
+        }
+
+        bool Replay(const D3D9TraceReader &trace, D3D9TraceReplayStats &stats);
+
+    protected:
+        bool Execute(const D3D9TraceReader &trace, const D3D9TraceCall &call, double &callMs);
+
+        void Reset();
+
+        core::runtime::graphics::IGraphicsBackend *m_Backend;
+        D3D9FrameBackend *m_FrameBackend;
+        std::function<void()> m_FrameCallback;
+
+        std::unordered_map<uint32_t, std::unique_ptr<core::runtime::graphics::IVertexBuffer>> m_VertexBuffers;
+        std::unordered_map<uint32_t, std::unique_ptr<core::runtime::graphics::IShader>> m_Shaders;
+        std::unordered_map<uint32_t, std::unique_ptr<core::runtime::graphics::IShaderProgram>> m_Programs;
+        std::unordered_map<uint32_t, std::unique_ptr<core::runtime::graphics::ITexture>> m_Textures;
+    };
+}
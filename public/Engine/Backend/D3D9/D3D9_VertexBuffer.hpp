@@ -1,20 +1,30 @@
 #pragma once
 
 #include <Engine/Core/Runtime/Graphics/IVertexBuffer.hpp>
+#include <Engine/Backend/D3D9/D3D9_ResourceRegistry.hpp>
+#include <Engine/Backend/D3D9/D3D9_MeshOptimizer.hpp>
+#include <Engine/Backend/D3D9/D3D9_Bounds.hpp>
+#include <Engine/Backend/D3D9/D3D9_ShaderConstants.hpp>
 
 // forward definition of D3D9 types
 struct IDirect3DDevice9;
 struct IDirect3DVertexBuffer9;
+struct IDirect3DIndexBuffer9;
 
 namespace engine::backend::dx9 {
-    struct D3D9VertexBuffer : public core::runtime::graphics::IVertexBuffer {
-        D3D9VertexBuffer(IDirect3DDevice9 *device) :
+    struct D3D9VertexBuffer : public core::runtime::graphics::IVertexBuffer, public D3D9DeviceResource {
+        D3D9VertexBuffer(IDirect3DDevice9 *device, D3D9ResourceRegistry *resourceRegistry = nullptr, D3D9ShaderConstants *shaderConstants = nullptr) :
                 m_Device{device},
+                m_ResourceRegistry{resourceRegistry},
+                m_ShaderConstants{shaderConstants},
                 m_VertexBuffer{nullptr},
                 m_VertexCount{0},
+                m_BufferCapacity{0},
                 m_UsageHint{core::runtime::graphics::BufferUsageHint::BUFFER_USAGE_HINT_STATIC},
                 m_PrimType{core::runtime::graphics::PrimitiveType::PRIMITIVE_TYPE_TRIANGLES} {}
 
+        ~D3D9VertexBuffer();
+
         bool Create() override;
 
         void Destroy() override;
@@ -37,14 +47,88 @@ namespace engine::backend::dx9 {
 
         std::vector<core::runtime::graphics::Vertex> Download() override;
 
+        void OnDeviceLost() override;
+
+        bool OnDeviceReset() override;
+
+        void OnRegistryDestroyed() override {
+            m_ResourceRegistry = nullptr;
+        }
+
+        // When enabled, static triangle lists are indexed and reordered for the vertex cache and vertex fetch
+        // on upload, then drawn with indexed draws. Meshes the device can't index, or whose index buffer can't be
+        // created, are drawn unindexed as uploaded. Takes effect on the next Upload.
+        void SetMeshOptimization(bool enabled) {
+            m_OptimizeMeshes = enabled;
+        }
+
+        bool IsIndexed() const {
+            return m_IsIndexed;
+        }
+
+        // Object space bounds for culling with D3D9FrustumCuller. Static uploads compute them from the vertices;
+        // dynamic and stream buffers keep whatever SetBounds gave them, and are unknown (never culled) until then.
+        // Buffers without vertices have empty bounds.
+        const D3D9BoundingVolume &GetBounds() const {
+            return m_Bounds;
+        }
+
+        void SetBounds(const D3D9BoundingVolume &bounds) {
+            m_Bounds = bounds;
+            m_HasOwnerBounds = true;
+        }
+
+        // cache statistics of the last optimized upload
+        const D3D9MeshOptimizationStats &GetMeshOptimizationStats() const {
+            return m_MeshStats;
+        }
+
     protected:
         size_t GetPrimitiveCount() const;
 
+        bool UploadVertices(
+                const std::vector<core::runtime::graphics::Vertex> &vertices,
+                core::runtime::graphics::PrimitiveType type,
+                core::runtime::graphics::BufferUsageHint usage,
+                bool isIndexed
+        );
+
+        // makes the buffer indexed once the indices reached the device
+        bool UploadIndices(std::vector<uint32_t> indices);
+
+        bool CreateDeviceBuffer(size_t capacity);
+
+        bool WriteVertices(const std::vector<core::runtime::graphics::Vertex> &data);
+
+        bool CreateIndexBuffer(size_t capacity);
+
+        bool WriteIndices(const std::vector<uint32_t> &indices);
+
+        void ReleaseIndexBuffer();
+
         IDirect3DDevice9 *m_Device;
+        D3D9ResourceRegistry *m_ResourceRegistry;
+        D3D9ShaderConstants *m_ShaderConstants;
         IDirect3DVertexBuffer9 *m_VertexBuffer;
         size_t m_VertexCount;
         size_t m_BufferCapacity;
         core::runtime::graphics::BufferUsageHint m_UsageHint;
         core::runtime::graphics::PrimitiveType m_PrimType;
+
+        // static contents kept in system memory so they can be restored after a device reset
+        std::vector<core::runtime::graphics::Vertex> m_ShadowData;
+
+        IDirect3DIndexBuffer9 *m_IndexBuffer = nullptr;
+        size_t m_IndexCount = 0;
+        size_t m_IndexCapacity = 0;
+        bool m_Use32BitIndices = false;
+        bool m_IsIndexed = false;
+        bool m_OptimizeMeshes = false;
+
+        // indices of an optimized mesh; always kept, as Download has to expand them again
+        std::vector<uint32_t> m_Indices;
+        D3D9MeshOptimizationStats m_MeshStats{};
+        D3D9BoundingVolume m_Bounds{};
+        bool m_HasOwnerBounds = false;
     };
 }
\ No newline at end of file
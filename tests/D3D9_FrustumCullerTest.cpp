@@ -0,0 +1,205 @@
+#include "D3D9_Test.hpp"
+
+#include <Engine/Backend/D3D9/D3D9_FrustumCuller.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace engine::backend::dx9;
+using engine::core::runtime::graphics::Vertex;
+using engine::backend::dx9::test::MakeVertex;
+
+static std::array<Vertex, 8> MakeBox(const glm::vec3 &min, const glm::vec3 &max) {
+    std::array<Vertex, 8> corners;
+    for (int i = 0; i < 8; ++i) {
+        corners[i] = MakeVertex(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+    }
+
+    return corners;
+}
+
+// OpenGL style projections, written out so the test doesn't depend on glm's helpers
+static glm::mat4 MakeOrtho(float extent) {
+    glm::mat4 matrix(1.0f);
+    matrix[0][0] = 1.0f / extent;
+    matrix[1][1] = 1.0f / extent;
+    matrix[2][2] = -1.0f / extent;
+
+    return matrix;
+}
+
+static glm::mat4 MakePerspective(float nearPlane, float farPlane) {
+    // 90 degree field of view, square viewport, looking down -z
+    glm::mat4 matrix(0.0f);
+    matrix[0][0] = 1.0f;
+    matrix[1][1] = 1.0f;
+    matrix[2][2] = -(farPlane + nearPlane) / (farPlane - nearPlane);
+    matrix[2][3] = -1.0f;
+    matrix[3][2] = -2.0f * farPlane * nearPlane / (farPlane - nearPlane);
+
+    return matrix;
+}
+
+static std::array<float, 4> ToClipSpace(const glm::mat4 &matrix, const Vertex &vertex) {
+    float position[3];
+    memcpy(position, &vertex, sizeof(position));
+
+    std::array<float, 4> clip{};
+    for (int row = 0; row < 4; ++row) {
+        clip[row] = matrix[3][row];
+        for (int column = 0; column < 3; ++column) {
+            clip[row] += matrix[column][row] * position[column];
+        }
+    }
+
+    return clip;
+}
+
+// brute force reference on the box corners: whether any corner is inside the frustum, and whether all corners
+// are outside the same clip plane
+static void ClassifyBox(const glm::mat4 &matrix, const std::array<Vertex, 8> &corners, bool &anyInside, bool &separated) {
+    std::array<std::array<float, 4>, 8> clip;
+    for (int i = 0; i < 8; ++i) {
+        clip[i] = ToClipSpace(matrix, corners[i]);
+    }
+
+    anyInside = false;
+    for (auto &c: clip) {
+        if (std::abs(c[0]) <= c[3] && std::abs(c[1]) <= c[3] && std::abs(c[2]) <= c[3]) {
+            anyInside = true;
+        }
+    }
+
+    separated = false;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (float side: {-1.0f, 1.0f}) {
+            bool allOutside = std::all_of(clip.begin(), clip.end(), [&](const std::array<float, 4> &c) {
+                return side * c[axis] > c[3];
+            });
+
+            separated |= allOutside;
+        }
+    }
+}
+
+static void TestComputeBounds() {
+    std::vector<Vertex> vertices = {MakeVertex(-1, 2, 0), MakeVertex(3, -2, 1), MakeVertex(1, 0, -1)};
+    auto bounds = D3D9_ComputeBounds(vertices);
+
+    D3D9_CHECK(bounds.m_IsValid);
+    D3D9_CHECK(bounds.m_Min.x == -1 && bounds.m_Min.y == -2 && bounds.m_Min.z == -1);
+    D3D9_CHECK(bounds.m_Max.x == 3 && bounds.m_Max.y == 2 && bounds.m_Max.z == 1);
+    D3D9_CHECK(bounds.m_Center.x == 1 && bounds.m_Center.y == 0 && bounds.m_Center.z == 0);
+
+    // the farthest vertex from the center (1, 0, 0) is (3, -2, 1), at distance 3
+    D3D9_CHECK(std::abs(bounds.m_Radius - 3.0f) < 1e-5f);
+
+    D3D9_CHECK(!D3D9_ComputeBounds({}).m_IsValid);
+    D3D9_CHECK(!D3D9_ComputeBounds({}).m_IsUnknown);
+    D3D9_CHECK(D3D9_TransformBounds(D3D9_UnknownBounds(), glm::mat4(1.0f)).m_IsUnknown);
+
+    glm::mat4 transform(1.0f);
+    transform[0][0] = 2.0f;
+    transform[3][0] = 10.0f;
+
+    auto moved = D3D9_TransformBounds(bounds, transform);
+    D3D9_CHECK(moved.m_Min.x == 8 && moved.m_Max.x == 16 && moved.m_Center.x == 12);
+    D3D9_CHECK(std::abs(moved.m_Radius - 6.0f) < 1e-5f);
+}
+
+// checks the culler against the brute force reference for random boxes; with an axis aligned orthographic
+// frustum the box test is exact, otherwise it has to be conservative
+static void TestRandomBoxes(const glm::mat4 &viewProjection, bool isExact, unsigned int seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-30.0f, 30.0f);
+    std::uniform_real_distribution<float> size(0.1f, 6.0f);
+
+    // not a multiple of four, so the padding of the last group is exercised
+    const size_t count = 4099;
+
+    D3D9FrustumCuller culler;
+    culler.Reserve(count);
+
+    std::vector<bool> anyInside(count), separated(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        glm::vec3 min(position(random), position(random), position(random));
+        glm::vec3 max = min + glm::vec3(size(random), size(random), size(random));
+
+        auto corners = MakeBox(min, max);
+        bool inside, outside;
+        ClassifyBox(viewProjection, corners, inside, outside);
+        anyInside[i] = inside;
+        separated[i] = outside;
+
+        D3D9_CHECK(culler.Add(D3D9_ComputeBounds(corners)) == i);
+    }
+
+    std::vector<uint32_t> visible;
+    culler.Cull(viewProjection, visible);
+
+    D3D9_CHECK(std::is_sorted(visible.begin(), visible.end()));
+    D3D9_CHECK(culler.GetStats().m_Tested == count);
+    D3D9_CHECK(culler.GetStats().m_Visible == visible.size());
+
+    std::vector<bool> isVisible(count, false);
+    for (auto index: visible) {
+        D3D9_CHECK(index < count);
+        if (index < count) isVisible[index] = true;
+    }
+
+    size_t missed = 0, kept = 0, mismatched = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (anyInside[i] && !isVisible[i]) missed++;
+        if (separated[i] && isVisible[i]) kept++;
+        if (isExact && isVisible[i] == separated[i]) mismatched++;
+    }
+
+    D3D9_CHECK(missed == 0);
+    D3D9_CHECK(kept == 0);
+    D3D9_CHECK(mismatched == 0);
+
+    // the random boxes have to cover both outcomes for the test to mean anything
+    D3D9_CHECK(!visible.empty() && visible.size() < count);
+}
+
+static void TestEmptyUnknownAndClear() {
+    D3D9FrustumCuller culler;
+    auto box = MakeBox(glm::vec3(-1.0f), glm::vec3(1.0f));
+
+    culler.Add(D3D9_ComputeBounds(box));
+    culler.Add(D3D9BoundingVolume{});
+    culler.Add(D3D9_ComputeBounds(box));
+
+    std::vector<uint32_t> visible;
+    D3D9_CHECK(culler.Cull(MakeOrtho(10.0f), visible) == 2);
+    D3D9_CHECK(visible.size() == 2 && visible[0] == 0 && visible[1] == 2);
+
+    // unknown bounds may be anywhere, so they pass wherever the frustum is
+    culler.Clear();
+    culler.Add(D3D9_UnknownBounds());
+    culler.Add(D3D9BoundingVolume{});
+
+    glm::mat4 away = MakeOrtho(10.0f);
+    away[3][0] = 1000.0f;
+
+    D3D9_CHECK(culler.Cull(away, visible) == 1 && visible[0] == 0);
+    D3D9_CHECK(culler.Cull(MakePerspective(1.0f, 40.0f), visible) == 1 && visible[0] == 0);
+
+    culler.Clear();
+    D3D9_CHECK(culler.Size() == 0);
+    D3D9_CHECK(culler.Cull(MakeOrtho(10.0f), visible) == 0 && visible.empty());
+}
+
+int main() {
+    TestComputeBounds();
+    TestRandomBoxes(MakeOrtho(10.0f), true, 1);
+    TestRandomBoxes(MakePerspective(1.0f, 40.0f), false, 2);
+    TestEmptyUnknownAndClear();
+
+    return D3D9_TEST_RESULT();
+}
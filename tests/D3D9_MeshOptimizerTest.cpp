@@ -0,0 +1,138 @@
+#include "D3D9_Test.hpp"
+
+#include <Engine/Backend/D3D9/D3D9_MeshOptimizer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace engine::backend::dx9;
+using engine::core::runtime::graphics::Vertex;
+using engine::backend::dx9::test::MakeVertex;
+
+using Triangle = std::array<unsigned char, sizeof(Vertex) * 3>;
+
+static Triangle MakeTriangle(const Vertex &a, const Vertex &b, const Vertex &c) {
+    Triangle triangle;
+    memcpy(triangle.data(), &a, sizeof(Vertex));
+    memcpy(triangle.data() + sizeof(Vertex), &b, sizeof(Vertex));
+    memcpy(triangle.data() + sizeof(Vertex) * 2, &c, sizeof(Vertex));
+
+    return triangle;
+}
+
+// a grid of quads as a triangle list in random triangle order, the worst case for the vertex cache
+static std::vector<Vertex> MakeShuffledGrid(int size) {
+    std::vector<std::array<Vertex, 3>> triangles;
+
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            auto v00 = MakeVertex(x, y), v10 = MakeVertex(x + 1, y), v11 = MakeVertex(x + 1, y + 1), v01 = MakeVertex(x, y + 1);
+            triangles.push_back({v00, v10, v11});
+            triangles.push_back({v00, v11, v01});
+        }
+    }
+
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1));
+
+    std::vector<Vertex> vertices;
+    for (auto &triangle: triangles) {
+        vertices.insert(vertices.end(), triangle.begin(), triangle.end());
+    }
+
+    return vertices;
+}
+
+static void TestOptimizeMesh() {
+    const int gridSize = 32;
+    auto source = MakeShuffledGrid(gridSize);
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    D3D9MeshOptimizationStats stats{};
+
+    D3D9_CHECK(D3D9_OptimizeMesh(source, vertices, indices, &stats));
+    D3D9_CHECK(indices.size() == source.size());
+    D3D9_CHECK(vertices.size() == static_cast<size_t>((gridSize + 1) * (gridSize + 1)));
+
+    // a shuffled grid barely reuses the cache; after reordering most vertices are transformed only once or twice
+    D3D9_CHECK(stats.m_Before.m_TriangleCount == stats.m_After.m_TriangleCount);
+    D3D9_CHECK(stats.m_After.m_ACMR < stats.m_Before.m_ACMR * 0.5);
+    D3D9_CHECK(stats.m_After.m_ATVR < stats.m_Before.m_ATVR);
+
+    // the stats have to agree with an analysis of the final index buffer
+    auto after = D3D9_AnalyzeVertexCache(indices, vertices.size());
+    D3D9_CHECK(after.m_TransformedVertices == stats.m_After.m_TransformedVertices);
+
+    // vertex fetch order: every index is at most one past the highest index seen so far
+    uint32_t next = 0;
+    bool isFetchOrdered = true;
+    for (auto index: indices) {
+        if (index > next) {
+            isFetchOrdered = false;
+        } else if (index == next) {
+            next++;
+        }
+    }
+
+    D3D9_CHECK(isFetchOrdered);
+    D3D9_CHECK(next == vertices.size());
+
+    // expanding the indices gives back the same triangles, with the same winding, in a different order
+    std::vector<Triangle> expected, actual;
+    for (size_t i = 0; i + 2 < source.size(); i += 3) {
+        expected.push_back(MakeTriangle(source[i], source[i + 1], source[i + 2]));
+    }
+
+    bool isInRange = true;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        if (indices[i] >= vertices.size() || indices[i + 1] >= vertices.size() || indices[i + 2] >= vertices.size()) {
+            isInRange = false;
+            break;
+        }
+
+        actual.push_back(MakeTriangle(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]]));
+    }
+
+    D3D9_CHECK(isInRange);
+
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    D3D9_CHECK(expected == actual);
+}
+
+static void TestAnalyzeVertexCache() {
+    // an unindexed list transforms every vertex of every triangle
+    std::vector<uint32_t> indices(30);
+    for (uint32_t i = 0; i < indices.size(); ++i) {
+        indices[i] = i;
+    }
+
+    auto stats = D3D9_AnalyzeVertexCache(indices, indices.size());
+    D3D9_CHECK(stats.m_TriangleCount == 10);
+    D3D9_CHECK(stats.m_ACMR == 3.0);
+    D3D9_CHECK(stats.m_ATVR == 1.0);
+
+    // the same triangle over and over only misses the cache once
+    std::vector<uint32_t> repeated = {0, 1, 2, 0, 1, 2, 0, 1, 2};
+    auto cached = D3D9_AnalyzeVertexCache(repeated, 3);
+    D3D9_CHECK(cached.m_TransformedVertices == 3);
+}
+
+static void TestDegenerateInput() {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+
+    D3D9_CHECK(!D3D9_OptimizeMesh({}, vertices, indices));
+    D3D9_CHECK(!D3D9_OptimizeMesh({MakeVertex(0, 0), MakeVertex(1, 0)}, vertices, indices));
+}
+
+int main() {
+    TestOptimizeMesh();
+    TestAnalyzeVertexCache();
+    TestDegenerateInput();
+
+    return D3D9_TEST_RESULT();
+}
@@ -0,0 +1,208 @@
+#include "D3D9_Test.hpp"
+
+#include <Engine/Backend/D3D9/D3D9_ShaderPack.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+using namespace engine::backend::dx9;
+
+// bytecode only has to be DWORD aligned data for the pack, it is never parsed
+static std::vector<unsigned char> MakeBytecode(unsigned char seed, size_t size) {
+    std::vector<unsigned char> bytecode(size);
+    for (size_t i = 0; i < size; ++i) {
+        bytecode[i] = static_cast<unsigned char>(seed + i);
+    }
+
+    return bytecode;
+}
+
+static std::vector<unsigned char> MakePack() {
+    D3D9ShaderPackWriter writer;
+
+    writer.AddShader("sprite.vs", SHADER_PACK_STAGE_VERTEX, MakeBytecode(1, 37), {
+            {"g_ViewProjection", 2, 0, 4, 3},
+            {"g_Time", 2, 4, 1, 0}
+    });
+    writer.AddShader("sprite.ps", SHADER_PACK_STAGE_FRAGMENT, MakeBytecode(100, 12), {
+            {"g_Texture", 3, 0, 1, 4}
+    });
+    writer.AddShader("blit.vs", SHADER_PACK_STAGE_VERTEX, MakeBytecode(50, 8), {});
+
+    return writer.Serialize();
+}
+
+static D3D9ShaderPackHeader &GetHeader(std::vector<unsigned char> &data) {
+    return *reinterpret_cast<D3D9ShaderPackHeader *>(data.data());
+}
+
+static D3D9ShaderPackEntry *GetEntries(std::vector<unsigned char> &data) {
+    return reinterpret_cast<D3D9ShaderPackEntry *>(data.data() + sizeof(D3D9ShaderPackHeader));
+}
+
+static bool IsValid(const std::vector<unsigned char> &data) {
+    D3D9ShaderPack pack;
+    return pack.OpenFromMemory(data);
+}
+
+static void TestRoundTrip() {
+    auto data = MakePack();
+
+    D3D9ShaderPack pack;
+    D3D9_CHECK(pack.OpenFromMemory(data));
+    D3D9_CHECK(pack.GetEntries().size() == 3);
+
+    auto entry = pack.Find("sprite.vs");
+    D3D9_CHECK(entry != nullptr);
+
+    if (entry) {
+        auto expected = MakeBytecode(1, 37);
+        auto bytecode = pack.GetBytecode(*entry);
+
+        D3D9_CHECK(pack.GetName(*entry) == "sprite.vs");
+        D3D9_CHECK(entry->m_Stage == SHADER_PACK_STAGE_VERTEX);
+        D3D9_CHECK(bytecode.size() == expected.size() && memcmp(bytecode.data(), expected.data(), expected.size()) == 0);
+        D3D9_CHECK(reinterpret_cast<uintptr_t>(bytecode.data()) % 4 == 0);
+
+        auto constants = pack.GetConstants(*entry);
+        D3D9_CHECK(constants.size() == 2);
+
+        if (constants.size() == 2) {
+            D3D9_CHECK(pack.GetString(constants[0].m_NameOffset, constants[0].m_NameLength) == "g_ViewProjection");
+            D3D9_CHECK(constants[0].m_RegisterIndex == 0 && constants[0].m_RegisterCount == 4 && constants[0].m_Class == 3);
+            D3D9_CHECK(pack.GetString(constants[1].m_NameOffset, constants[1].m_NameLength) == "g_Time");
+            D3D9_CHECK(constants[1].m_RegisterIndex == 4 && constants[1].m_RegisterCount == 1);
+            D3D9_CHECK(pack.GetStringTable().substr(constants[1].m_NameOffset, constants[1].m_NameLength) == "g_Time");
+        }
+    }
+
+    auto fragment = pack.Find("sprite.ps");
+    D3D9_CHECK(fragment != nullptr && fragment->m_Stage == SHADER_PACK_STAGE_FRAGMENT);
+
+    auto blit = pack.Find("blit.vs");
+    D3D9_CHECK(blit != nullptr && pack.GetConstants(*blit).empty());
+
+    D3D9_CHECK(pack.Find("missing.vs") == nullptr);
+}
+
+static void TestOpenFile() {
+    auto path = (std::filesystem::temp_directory_path() / "rift_d3d9_shader_pack_test.rspk").string();
+
+    D3D9ShaderPackWriter writer;
+    writer.AddShader("sprite.vs", SHADER_PACK_STAGE_VERTEX, MakeBytecode(1, 16), {});
+    D3D9_CHECK(writer.Write(path));
+
+    {
+        D3D9ShaderPack pack;
+        D3D9_CHECK(pack.Open(path));
+        D3D9_CHECK(pack.Find("sprite.vs") != nullptr);
+    }
+
+    std::filesystem::remove(path);
+
+    D3D9ShaderPack missing;
+    D3D9_CHECK(!missing.Open(path));
+}
+
+static void TestMalformed() {
+    auto valid = MakePack();
+    D3D9_CHECK(IsValid(valid));
+
+    // truncated header
+    {
+        std::vector<unsigned char> data(valid.begin(), valid.begin() + sizeof(D3D9ShaderPackHeader) - 1);
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    // truncated bytecode
+    {
+        std::vector<unsigned char> data(valid.begin(), valid.end() - 4);
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    {
+        auto data = valid;
+        GetHeader(data).m_Magic = 0;
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    {
+        auto data = valid;
+        GetHeader(data).m_Version = D3D9_SHADER_PACK_VERSION + 1;
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    // entry table larger than the file
+    {
+        auto data = valid;
+        GetHeader(data).m_EntryCount = 0x10000000;
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    {
+        auto data = valid;
+        GetHeader(data).m_StringTableSize = static_cast<uint32_t>(data.size());
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    {
+        auto data = valid;
+        GetEntries(data)[0].m_BytecodeOffset = static_cast<uint32_t>(data.size());
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    // Create*Shader needs DWORD aligned bytecode
+    {
+        auto data = valid;
+        GetEntries(data)[0].m_BytecodeOffset += 1;
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    {
+        auto data = valid;
+        GetEntries(data)[0].m_FirstConstant = GetHeader(data).m_ConstantCount;
+        GetEntries(data)[0].m_ConstantCount = 1;
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    {
+        auto data = valid;
+        GetEntries(data)[1].m_NameLength = GetHeader(data).m_StringTableSize + 1;
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    {
+        auto data = valid;
+        GetEntries(data)[2].m_Stage = 7;
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    // entries out of hash order would make Find miss shaders that are in the pack
+    {
+        auto data = valid;
+        std::swap(GetEntries(data)[0], GetEntries(data)[2]);
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    {
+        auto data = valid;
+        GetEntries(data)[1].m_NameHash ^= 1;
+        D3D9_CHECK(!IsValid(data));
+    }
+
+    {
+        auto data = valid;
+        auto constants = reinterpret_cast<D3D9ShaderPackConstant *>(data.data() + sizeof(D3D9ShaderPackHeader) + 3 * sizeof(D3D9ShaderPackEntry));
+        constants[0].m_NameOffset = GetHeader(data).m_StringTableSize;
+        D3D9_CHECK(!IsValid(data));
+    }
+}
+
+int main() {
+    TestRoundTrip();
+    TestOpenFile();
+    TestMalformed();
+
+    return D3D9_TEST_RESULT();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+
+#include <Engine/Core/Runtime/Graphics/IVertexBuffer.hpp>
+
+// Minimal checks for the backend tests; every test is a plain executable registered with ctest that
+// returns the number of failed checks.
+namespace engine::backend::dx9::test {
+    inline int g_FailedChecks = 0;
+
+    // the position is the first element of the vertex, the rest stays zero
+    inline core::runtime::graphics::Vertex MakeVertex(float x, float y, float z = 0.0f) {
+        core::runtime::graphics::Vertex vertex{};
+        const float position[3] = {x, y, z};
+        memcpy(&vertex, position, sizeof(position));
+
+        return vertex;
+    }
+}
+
+#define D3D9_CHECK(condition)                                                                   \
+    do {                                                                                        \
+        if (!(condition)) {                                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);       \
+            engine::backend::dx9::test::g_FailedChecks++;                                       \
+        }                                                                                       \
+    } while (0)
+
+#define D3D9_TEST_RESULT() (engine::backend::dx9::test::g_FailedChecks == 0 ? 0 : 1)
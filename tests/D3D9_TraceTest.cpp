@@ -0,0 +1,321 @@
+#include "D3D9_Test.hpp"
+
+#include <Engine/Backend/D3D9/D3D9_NullBackend.hpp>
+#include <Engine/Backend/D3D9/D3D9_TraceBackend.hpp>
+#include <Engine/Backend/D3D9/D3D9_TraceReplayer.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+using namespace engine;
+using namespace engine::backend::dx9;
+using namespace engine::core::runtime::graphics;
+using engine::backend::dx9::test::MakeVertex;
+
+static std::string GetTracePath(const char *name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// a few frames of a small scene; every frame re-uploads the same vertices, which the trace stores only once
+static void RecordScene(D3D9TraceBackend &backend, int frameCount) {
+    backend.Initialize();
+    backend.SetViewport({0, 0}, {640, 480});
+    backend.EnableFeatures(BACKEND_FEATURE_ALPHA_BLENDING);
+
+    auto program = backend.CreateShaderProgram();
+
+    auto vertexShader = backend.CreateShader();
+    vertexShader->SetSource("float4 main(float4 p : POSITION) : POSITION { return p; }", ShaderType::SHADER_TYPE_VERTEX);
+    vertexShader->Compile();
+
+    std::vector<unsigned char> bytecode = {0x00, 0x03, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00};
+    auto fragmentShader = backend.CreateShader();
+    fragmentShader->UseCompiledShader(bytecode, ShaderType::SHADER_TYPE_FRAGMENT);
+
+    program->AddShader(std::move(vertexShader));
+    program->AddShader(std::move(fragmentShader));
+    program->Link();
+
+    auto texture = backend.CreateTexture();
+    texture->Create(Bitmap({2, 2}, std::vector<Color>(4, Color{})));
+
+    auto buffer = backend.CreateVertexBuffer();
+    buffer->Create();
+
+    std::vector<Vertex> triangle = {MakeVertex(0, 0), MakeVertex(1, 0), MakeVertex(0, 1)};
+
+    for (int frame = 0; frame < frameCount; ++frame) {
+        backend.Clear(Color{});
+
+        program->Bind();
+        program->SetUniformMat4("g_ViewProjection", glm::mat4(1.0f));
+        program->SetUniformI("g_Frame", frame);
+        texture->Bind(0);
+
+        buffer->Upload(triangle, PrimitiveType::PRIMITIVE_TYPE_TRIANGLES, BufferUsageHint::BUFFER_USAGE_HINT_DYNAMIC);
+        buffer->Draw();
+
+        backend.MarkFrame();
+    }
+
+    // released before the end of the trace, so the replay frees them at the same points
+    buffer.reset();
+    texture.reset();
+    program.reset();
+
+    backend.Shutdown();
+}
+
+static bool IsSameCall(const D3D9TraceCall &a, const D3D9TraceCall &b) {
+    return a.m_Op == b.m_Op &&
+           a.m_Object == b.m_Object &&
+           a.m_Payload.size() == b.m_Payload.size() &&
+           std::equal(a.m_Payload.begin(), a.m_Payload.end(), b.m_Payload.begin());
+}
+
+static size_t CountCalls(const D3D9TraceReader &trace, D3D9TraceOp op) {
+    return std::count_if(trace.Calls().begin(), trace.Calls().end(), [op](const D3D9TraceCall &call) {
+        return call.m_Op == op;
+    });
+}
+
+static void TestRecordAndReplay() {
+    const int frameCount = 3;
+    auto recordedPath = GetTracePath("rift_d3d9_trace_test.rdtr");
+    auto replayedPath = GetTracePath("rift_d3d9_trace_test_replay.rdtr");
+
+    D3D9NullBackend nullBackend;
+
+    {
+        D3D9TraceWriter writer;
+        D3D9_CHECK(writer.Open(recordedPath));
+
+        D3D9TraceBackend backend(&nullBackend, &writer);
+        RecordScene(backend, frameCount);
+
+        // vertex source, bytecode, pixels and vertices are unique; the other uploads reuse the vertex blob
+        auto &stats = writer.GetStats();
+        D3D9_CHECK(stats.m_Blobs == 4);
+        D3D9_CHECK(stats.m_DeduplicatedBlobs == frameCount - 1);
+        D3D9_CHECK(stats.m_DeduplicatedBytes == (frameCount - 1) * 3 * sizeof(Vertex));
+    }
+
+    D3D9TraceReader recorded;
+    D3D9_CHECK(recorded.Open(recordedPath));
+    D3D9_CHECK(recorded.GetBlobCount() == 4);
+    D3D9_CHECK(CountCalls(recorded, TRACE_OP_BLOB) == 0);
+    D3D9_CHECK(CountCalls(recorded, TRACE_OP_VERTEX_BUFFER_UPLOAD) == frameCount);
+    D3D9_CHECK(CountCalls(recorded, TRACE_OP_VERTEX_BUFFER_DRAW) == frameCount);
+    D3D9_CHECK(CountCalls(recorded, TRACE_OP_FRAME) == frameCount);
+
+    // every upload references the same blob
+    std::vector<D3D9TraceBlobKey> uploadKeys;
+    for (auto &call: recorded.Calls()) {
+        if (call.m_Op == TRACE_OP_VERTEX_BUFFER_UPLOAD) {
+            D3D9TracePayloadReader payload(call.m_Payload);
+            uploadKeys.push_back(payload.ReadBlobKey());
+        }
+    }
+
+    D3D9_CHECK(std::all_of(uploadKeys.begin(), uploadKeys.end(), [&](const D3D9TraceBlobKey &key) {
+        return key == uploadKeys.front() && recorded.FindBlob(key).size() == 3 * sizeof(Vertex);
+    }));
+
+    // replaying through a second tracing backend records what the null backend received
+    {
+        D3D9TraceWriter writer;
+        D3D9_CHECK(writer.Open(replayedPath));
+
+        D3D9TraceBackend backend(&nullBackend, &writer);
+        D3D9TraceReplayer replayer(&backend);
+        replayer.SetFrameCallback([&] { backend.MarkFrame(); });
+
+        D3D9TraceReplayStats stats;
+        D3D9_CHECK(replayer.Replay(recorded, stats));
+        D3D9_CHECK(stats.m_Errors == 0);
+        D3D9_CHECK(stats.m_FrameTimesMs.size() == frameCount);
+        D3D9_CHECK(stats.m_CallTimesMs.size() == recorded.Calls().size());
+        D3D9_CHECK(stats.m_Ops[TRACE_OP_VERTEX_BUFFER_DRAW].m_Count == frameCount);
+
+        // the replay can be repeated on the same backend
+        D3D9TraceReplayStats again;
+        D3D9_CHECK(D3D9TraceReplayer(&nullBackend).Replay(recorded, again));
+    }
+
+    D3D9TraceReader replayed;
+    D3D9_CHECK(replayed.Open(replayedPath));
+
+    // the replayer leaves Initialize and Shutdown to the owner of the backend
+    std::vector<D3D9TraceCall> expected;
+    for (auto &call: recorded.Calls()) {
+        if (call.m_Op != TRACE_OP_BACKEND_INITIALIZE && call.m_Op != TRACE_OP_BACKEND_SHUTDOWN) {
+            expected.push_back(call);
+        }
+    }
+
+    D3D9_CHECK(replayed.Calls().size() == expected.size());
+    D3D9_CHECK(std::equal(expected.begin(), expected.end(), replayed.Calls().begin(), replayed.Calls().end(), IsSameCall));
+    D3D9_CHECK(replayed.GetBlobCount() == recorded.GetBlobCount());
+
+    std::filesystem::remove(recordedPath);
+    std::filesystem::remove(replayedPath);
+}
+
+// remembers the frame calls it receives
+struct D3D9FrameRecordingBackend : public D3D9NullBackend {
+    bool Clear(const D3D9ClearDesc &desc) override {
+        m_Clears.push_back(desc);
+        return true;
+    }
+
+    void BeginFrame(const D3D9ClearDesc &clear) override {
+        m_BeginFrames.push_back(clear);
+    }
+
+    void EndFrame() override {
+        m_EndFrames++;
+    }
+
+    using D3D9NullBackend::Clear;
+
+    std::vector<D3D9ClearDesc> m_BeginFrames;
+    std::vector<D3D9ClearDesc> m_Clears;
+    int m_EndFrames = 0;
+};
+
+static bool IsSameClear(const D3D9ClearDesc &a, const D3D9ClearDesc &b) {
+    return a.m_Flags == b.m_Flags &&
+           memcmp(&a.m_Color, &b.m_Color, sizeof(Color)) == 0 &&
+           a.m_Depth == b.m_Depth &&
+           a.m_Stencil == b.m_Stencil &&
+           a.m_Rects.size() == b.m_Rects.size() &&
+           (a.m_Rects.empty() || memcmp(a.m_Rects.data(), b.m_Rects.data(), a.m_Rects.size() * sizeof(D3D9ClearRect)) == 0);
+}
+
+static void TestFrameOps() {
+    const int frameCount = 2;
+    auto path = GetTracePath("rift_d3d9_trace_frame_test.rdtr");
+
+    D3D9ClearDesc frameClear;
+    frameClear.m_Flags = CLEAR_ALL;
+    frameClear.m_Depth = 0.5f;
+    frameClear.m_Stencil = 7;
+
+    D3D9ClearDesc rectClear;
+    rectClear.m_Flags = CLEAR_COLOR;
+    rectClear.m_Rects = {{0, 0, 16, 16}, {32, 32, 64, 48}};
+
+    {
+        D3D9NullBackend nullBackend;
+        D3D9TraceWriter writer;
+        D3D9_CHECK(writer.Open(path));
+
+        D3D9FrameTraceBackend backend(&nullBackend, &nullBackend, &writer);
+        for (int frame = 0; frame < frameCount; ++frame) {
+            backend.BeginFrame(frameClear);
+            D3D9_CHECK(backend.Clear(rectClear));
+            backend.EndFrame();
+            backend.MarkFrame();
+        }
+    }
+
+    D3D9TraceReader trace;
+    D3D9_CHECK(trace.Open(path));
+    D3D9_CHECK(CountCalls(trace, TRACE_OP_BACKEND_BEGIN_FRAME) == frameCount);
+    D3D9_CHECK(CountCalls(trace, TRACE_OP_BACKEND_CLEAR_DESC) == frameCount);
+    D3D9_CHECK(CountCalls(trace, TRACE_OP_BACKEND_END_FRAME) == frameCount);
+
+    // the frames and clears arrive at the replay backend unchanged
+    D3D9FrameRecordingBackend recording;
+    D3D9TraceReplayStats stats;
+    D3D9_CHECK(D3D9TraceReplayer(&recording, &recording).Replay(trace, stats));
+    D3D9_CHECK(stats.m_Errors == 0);
+    D3D9_CHECK(recording.m_BeginFrames.size() == frameCount && recording.m_Clears.size() == frameCount);
+    D3D9_CHECK(recording.m_EndFrames == frameCount);
+    D3D9_CHECK(std::all_of(recording.m_BeginFrames.begin(), recording.m_BeginFrames.end(), [&](const D3D9ClearDesc &desc) {
+        return IsSameClear(desc, frameClear);
+    }));
+    D3D9_CHECK(std::all_of(recording.m_Clears.begin(), recording.m_Clears.end(), [&](const D3D9ClearDesc &desc) {
+        return IsSameClear(desc, rectClear);
+    }));
+
+    // a replay without a frame backend can't issue them
+    D3D9_CHECK(!D3D9TraceReplayer(&recording).Replay(trace, stats));
+    D3D9_CHECK(stats.m_Errors == frameCount * 3);
+
+    std::filesystem::remove(path);
+}
+
+static void TestReplayErrors() {
+    // calls on objects that were never created are counted, the rest of the trace still replays
+    D3D9TracePayload payload;
+    payload.Write(int32_t(0));
+
+    std::vector<unsigned char> data(sizeof(D3D9TraceHeader));
+    auto header = reinterpret_cast<D3D9TraceHeader *>(data.data());
+    header->m_Magic = D3D9_TRACE_MAGIC;
+    header->m_Version = D3D9_TRACE_VERSION;
+
+    auto append = [&](D3D9TraceOp op, uint32_t object, const std::vector<unsigned char> &bytes) {
+        D3D9TraceRecord record{};
+        record.m_Op = op;
+        record.m_Object = object;
+        record.m_PayloadSize = static_cast<uint32_t>(bytes.size());
+
+        auto recordBytes = reinterpret_cast<const unsigned char *>(&record);
+        data.insert(data.end(), recordBytes, recordBytes + sizeof(record));
+        data.insert(data.end(), bytes.begin(), bytes.end());
+    };
+
+    append(TRACE_OP_TEXTURE_BIND, 42, payload.m_Data);
+    append(TRACE_OP_FRAME, 0, {});
+
+    D3D9TraceReader trace;
+    D3D9_CHECK(trace.OpenFromMemory(data));
+
+    D3D9NullBackend nullBackend;
+    D3D9TraceReplayer replayer(&nullBackend);
+
+    D3D9TraceReplayStats stats;
+    D3D9_CHECK(!replayer.Replay(trace, stats));
+    D3D9_CHECK(stats.m_Errors == 1);
+    D3D9_CHECK(stats.m_FrameTimesMs.size() == 1);
+
+    // a record that claims more payload than the file has
+    data.resize(data.size() - 1);
+    D3D9_CHECK(!D3D9TraceReader().OpenFromMemory(data));
+}
+
+static void TestNullBackend() {
+    D3D9NullBackend backend;
+    D3D9_CHECK(backend.Initialize());
+
+    backend.EnableFeatures(static_cast<BackendFeature>(BACKEND_FEATURE_ALPHA_BLENDING | BACKEND_FEATURE_SCISSOR_TEST));
+    backend.DisableFeatures(BACKEND_FEATURE_SCISSOR_TEST);
+    D3D9_CHECK(backend.GetActiveFeatures() == BACKEND_FEATURE_ALPHA_BLENDING);
+
+    auto buffer = backend.CreateVertexBuffer();
+    std::vector<Vertex> vertices = {MakeVertex(1, 2), MakeVertex(3, 4)};
+    buffer->Upload(vertices, PrimitiveType::PRIMITIVE_TYPE_LINES, BufferUsageHint::BUFFER_USAGE_HINT_STATIC);
+    D3D9_CHECK(buffer->Size() == 2);
+    D3D9_CHECK(buffer->GetPrimitiveType() == PrimitiveType::PRIMITIVE_TYPE_LINES);
+    D3D9_CHECK(buffer->Download().size() == 2 && memcmp(buffer->Download().data(), vertices.data(), 2 * sizeof(Vertex)) == 0);
+
+    auto shader = backend.CreateShader();
+    D3D9_CHECK(!shader->Compile());
+    shader->SetSource("source", ShaderType::SHADER_TYPE_VERTEX);
+    D3D9_CHECK(shader->Compile() && shader->IsCompiled() && shader->GetSource() == "source");
+
+    backend.Shutdown();
+}
+
+int main() {
+    TestRecordAndReplay();
+    TestFrameOps();
+    TestReplayErrors();
+    TestNullBackend();
+
+    return D3D9_TEST_RESULT();
+}
@@ -0,0 +1,206 @@
+// Offline shader pack builder.
+// Usage: Rift_Backend_D3D9_ShaderPacker <shader directory> <output pack>
+//
+// Every "<name>.vs.hlsl" / "<name>.ps.hlsl" file below the directory is compiled with the same entry point and
+// profiles used by D3D9Shader::Compile and stored under "<relative path>/<name>.vs" or ".ps". Other .hlsl files
+// are only reachable through #include: "file" resolves next to the including file, <file> from the shader directory.
+
+#include <Engine/Backend/D3D9/D3D9_ShaderPack.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+#include <d3d9.h>
+#include <d3dx9.h>
+
+using namespace engine::backend::dx9;
+
+static bool ReadFile(const std::filesystem::path &path, std::string &contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    std::stringstream source;
+    source << file.rdbuf();
+    contents = source.str();
+
+    return true;
+}
+
+class ShaderInclude : public ID3DXInclude {
+public:
+    ShaderInclude(std::filesystem::path root, std::filesystem::path sourceDirectory) :
+            m_Root(std::move(root)),
+            m_SourceDirectory(std::move(sourceDirectory)) {}
+
+    STDMETHOD(Open)(THIS_ D3DXINCLUDE_TYPE type, LPCSTR fileName, LPCVOID parentData, LPCVOID *data, UINT *bytes) override {
+        // the compiler hands back the buffer of the including file, which tells where to look for "file" includes
+        auto parent = m_Directories.find(parentData);
+        auto directory = type == D3DXINC_SYSTEM ? m_Root : parent != m_Directories.end() ? parent->second : m_SourceDirectory;
+        auto path = directory / fileName;
+
+        std::string contents;
+        if (!ReadFile(path, contents)) {
+            fprintf(stderr, "%s: include file not found\n", path.string().c_str());
+            return E_FAIL;
+        }
+
+        auto buffer = new char[contents.size() + 1];
+        memcpy(buffer, contents.c_str(), contents.size() + 1);
+
+        m_Directories[buffer] = path.parent_path();
+
+        *data = buffer;
+        *bytes = static_cast<UINT>(contents.size());
+        return S_OK;
+    }
+
+    STDMETHOD(Close)(THIS_ LPCVOID data) override {
+        m_Directories.erase(data);
+        delete[] static_cast<const char *>(data);
+        return S_OK;
+    }
+
+private:
+    std::filesystem::path m_Root;
+    std::filesystem::path m_SourceDirectory;
+    std::unordered_map<LPCVOID, std::filesystem::path> m_Directories;
+};
+
+static bool CompileShader(
+        const std::filesystem::path &root,
+        const std::filesystem::path &path,
+        D3D9ShaderPackStage stage,
+        const std::string &name,
+        D3D9ShaderPackWriter &writer
+) {
+    std::string code;
+    if (!ReadFile(path, code)) {
+        fprintf(stderr, "%s: failed to read the file\n", path.string().c_str());
+        return false;
+    }
+
+    ShaderInclude include(root, path.parent_path());
+
+    ID3DXBuffer *compiled = nullptr;
+    ID3DXBuffer *errors = nullptr;
+    ID3DXConstantTable *constantTable = nullptr;
+
+    HRESULT hr = D3DXCompileShader(
+            code.c_str(),
+            static_cast<UINT>(code.size()),
+            nullptr,
+            &include,
+            "main",
+            stage == SHADER_PACK_STAGE_VERTEX ? "vs_3_0" : "ps_3_0",
+            0,
+            &compiled,
+            &errors,
+            &constantTable
+    );
+
+    if (FAILED(hr)) {
+        fprintf(stderr, "%s: compilation failed\n", path.string().c_str());
+
+        if (errors) {
+            fprintf(stderr, "%.*s\n", static_cast<int>(errors->GetBufferSize()), static_cast<const char *>(errors->GetBufferPointer()));
+            errors->Release();
+        }
+
+        return false;
+    }
+
+    std::vector<D3D9ShaderPackWriter::Constant> constants;
+
+    D3DXCONSTANTTABLE_DESC tableDesc;
+    if (constantTable && SUCCEEDED(constantTable->GetDesc(&tableDesc))) {
+        for (UINT i = 0; i < tableDesc.Constants; ++i) {
+            D3DXCONSTANT_DESC desc;
+            UINT count = 1;
+
+            if (FAILED(constantTable->GetConstantDesc(constantTable->GetConstant(nullptr, i), &desc, &count))) {
+                continue;
+            }
+
+            constants.push_back({
+                    desc.Name,
+                    static_cast<uint16_t>(desc.RegisterSet),
+                    static_cast<uint16_t>(desc.RegisterIndex),
+                    static_cast<uint16_t>(desc.RegisterCount),
+                    static_cast<uint16_t>(desc.Class)
+            });
+        }
+    }
+
+    writer.AddShader(
+            name,
+            stage,
+            {static_cast<const unsigned char *>(compiled->GetBufferPointer()), compiled->GetBufferSize()},
+            std::move(constants)
+    );
+
+    compiled->Release();
+
+    if (errors) {
+        errors->Release();
+    }
+
+    if (constantTable) {
+        constantTable->Release();
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <shader directory> <output pack>\n", argv[0]);
+        return 1;
+    }
+
+    std::filesystem::path root(argv[1]);
+    D3D9ShaderPackWriter writer;
+
+    size_t shaderCount = 0;
+    bool ok = true;
+
+    for (auto &file: std::filesystem::recursive_directory_iterator(root)) {
+        if (!file.is_regular_file() || file.path().extension() != ".hlsl") {
+            continue;
+        }
+
+        // "<name>.vs.hlsl" -> "<name>.vs"
+        auto relative = std::filesystem::relative(file.path(), root).replace_extension().generic_string();
+        auto stageExtension = std::filesystem::path(relative).extension();
+
+        D3D9ShaderPackStage stage;
+        if (stageExtension == ".vs") {
+            stage = SHADER_PACK_STAGE_VERTEX;
+        } else if (stageExtension == ".ps") {
+            stage = SHADER_PACK_STAGE_FRAGMENT;
+        } else {
+            // shared code pulled in through #include
+            continue;
+        }
+
+        ok &= CompileShader(root, file.path(), stage, relative, writer);
+        shaderCount++;
+    }
+
+    if (!ok) {
+        return 1;
+    }
+
+    if (!writer.Write(argv[2])) {
+        fprintf(stderr, "failed to write %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("packed %u shaders into %s\n", static_cast<unsigned int>(shaderCount), argv[2]);
+    return 0;
+}